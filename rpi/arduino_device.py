@@ -2,19 +2,127 @@ STATUS_TAG_PRESENT = 0x01
 STATUS_TIMER_RUNNING = 0x02
 STATUS_ALARM_ACTIVE = 0x04
 
+# Event types of the node FIFO (drivers/events/event_fifo.h)
+EVENT_TAG_REMOVED = 1
+EVENT_TAG_RETURNED = 2
+EVENT_ALARM_STARTED = 3
+EVENT_ALARM_STOPPED = 4
+EVENT_ALARM_ACKED = 5
+SEQ_WRAP = 255  # 0 is never used
+EVENT_FIFO_LENGTH = 8  # records held by the node
+
+# Bits of the REG_TAG_MAP bitmaps (drivers/tags/tag_table.h)
+TAG_TABLE_MAX = 16
+
+# Order of the records in REG_TASK_STATS
+TASK_NAMES = ["ReadTag", "Logic", "Timers", "Idle"]
+RUN_TIME_WRAP = 1 << 32
+
 
 class ArduinoDevice:
-    def __init__(self, id, name, address, timeout_minutes, toalert_email):
+    def __init__(self, id, name, address, timeout_minutes, toalert_email, bus=1, mux=None, channel=None):
+        """The node is reached at (bus, mux channel, address): mux is the
+        address of the TCA9548A it sits behind, None when wired directly."""
         self.id = id
         self.name = name
         self.address = address
+        self.bus = bus
+        self.mux = mux
+        self.channel = channel
         self.timeout_minutes = timeout_minutes
         self.toalert_email = toalert_email
         self.last_status = None
+        self.last_snapshot = None
+        self.last_task_stats = None
+        self.last_event_seq = None
+        self.tag_map = None  # (count, present, timer, alarm) bitmaps of the node tag table
+        self.tag_names = []  # read once from the tag pages when the node has several tags
+        self.failures = 0  # polls in a row without an answer
+
+    def location(self):
+        """Unique key of the node on the gateway"""
+        return self.bus, self.mux, self.channel, self.address
 
     def poll(self, i2c_master):
-        self.last_status = i2c_master.read_status(self.address)
-        return self.last_status
+        """Refresh the cached snapshot if the node state changed.
+
+        Return True when the node reported a change since the previous poll:
+        one 2-byte read per poll otherwise.
+        """
+        return self.update(i2c_master, i2c_master.read_generation(self.address))
+
+    def update(self, i2c_master, generation):
+        """Same as poll() with REG_GENERATION already read (None: no answer)"""
+        self.failures = self.failures + 1 if generation is None else 0
+        if generation is None:
+            self.last_status = None
+            return False
+        if self.last_snapshot is not None and generation == self.last_snapshot["generation"]:
+            return False
+
+        self.last_snapshot = i2c_master.read_snapshot(self.address)
+        self.last_status = self.last_snapshot["status"] if self.last_snapshot else None
+        if self.last_snapshot is not None:
+            self.update_tag_map(i2c_master)
+        return self.last_snapshot is not None
+
+    def update_tag_map(self, i2c_master):
+        """Refresh the per-tag bitmaps, one short read for the whole table"""
+        tag_map = i2c_master.read_tag_map(self.address)
+        if tag_map is None or not 0 < tag_map[0] <= TAG_TABLE_MAX:
+            return  # firmware without a tag table
+        self.tag_map = tag_map
+        if tag_map[0] > 1 and len(self.tag_names) != tag_map[0]:
+            pages = [i2c_master.read_tag_page(self.address, i) for i in range(tag_map[0])]
+            if None not in pages:
+                self.tag_names = [page["name"] for page in pages]
+
+    def tag_name(self, index):
+        """Name of a tag of the node table, None when the node watches a single tag"""
+        if len(self.tag_names) > 1 and index < len(self.tag_names):
+            return self.tag_names[index]
+        return None
+
+    def drain_events(self, i2c_master):
+        """Return (events, lost): the node events since the previous call and
+        how many were overwritten on the node before being read."""
+        drained = i2c_master.read_events(self.address) or []
+        events = []
+        lost = 0
+        for event in drained:
+            seq = event[0]
+            if self.last_event_seq is not None:
+                if (self.last_event_seq - seq) % SEQ_WRAP < EVENT_FIFO_LENGTH:
+                    # Read again after a lost acknowledgement
+                    continue
+                lost += (seq - self.last_event_seq - 1) % SEQ_WRAP
+            self.last_event_seq = seq
+            events.append(event)
+        return events, lost
+
+    def timer_left(self):
+        """Seconds before the alarm, 0 when the timer is not running"""
+        return self.last_snapshot["timer_left"] if self.last_snapshot else None
+
+    def poll_task_stats(self, i2c_master):
+        """Return [(name, stack_free_words, cpu_share)] since the previous call.
+
+        The first call only takes the reference sample and returns None.
+        """
+        stats = i2c_master.read_task_stats(self.address)
+        previous = self.last_task_stats
+        if stats is None:
+            return None
+        self.last_task_stats = stats
+        if previous is None:
+            return None
+
+        elapsed = (stats[0] - previous[0]) % RUN_TIME_WRAP
+        report = []
+        for name, (stack_free, run_time), (_, previous_run_time) in zip(TASK_NAMES, stats[1], previous[1]):
+            used = (run_time - previous_run_time) % RUN_TIME_WRAP
+            report.append((name, stack_free, used / elapsed if elapsed else 0.0))
+        return report
 
     def is_tag_present(self):
         return self.last_status is not None and (self.last_status & STATUS_TAG_PRESENT)
@@ -0,0 +1,69 @@
+"""Attention line shared by the nodes (open-drain, active low, wired-OR).
+
+A node pulls the line low whenever its generation counter changes and
+releases it once the gateway has read REG_GENERATION or REG_SNAPSHOT.
+The gateway waits on the line instead of sleeping between sweeps.
+"""
+import threading
+
+
+class GpiodAttentionLine:
+    """Line read through the GPIO character device (libgpiod >= 2)"""
+
+    def __init__(self, chip="/dev/gpiochip0", line=17):
+        import gpiod
+        from gpiod.line import Bias, Direction, Edge, Value
+
+        self._line = line
+        self._active = Value.ACTIVE
+        self._request = gpiod.request_lines(
+            chip,
+            consumer="lab-o-track",
+            config={line: gpiod.LineSettings(direction=Direction.INPUT, edge_detection=Edge.BOTH,
+                                             bias=Bias.PULL_UP, active_low=True)},
+        )
+
+    def is_asserted(self):
+        return self._request.get_value(self._line) == self._active
+
+    def wait(self, timeout):
+        """Return True as soon as the line is asserted, False after timeout seconds"""
+        if self.is_asserted():
+            return True
+        if self._request.wait_edge_events(timeout):
+            self._request.read_edge_events()
+        return self.is_asserted()
+
+    def close(self):
+        self._request.release()
+
+
+class MockAttentionLine:
+    """In-memory line, asserted by hand (tests, or running without the wire)"""
+
+    def __init__(self):
+        self._asserted = threading.Event()
+
+    def assert_line(self):
+        self._asserted.set()
+
+    def release(self):
+        self._asserted.clear()
+
+    def is_asserted(self):
+        return self._asserted.is_set()
+
+    def wait(self, timeout):
+        return self._asserted.wait(timeout)
+
+    def close(self):
+        pass
+
+
+def open_attention_line(config):
+    """Line described by the "attention" config section, or None to poll blindly"""
+    if not config:
+        return None
+    if config.get("mock"):
+        return MockAttentionLine()
+    return GpiodAttentionLine(config.get("chip", "/dev/gpiochip0"), config.get("line", 17))
@@ -0,0 +1,51 @@
+"""Everything the gateway does on one I2C bus.
+
+The nodes of a bus are grouped by multiplexer channel, in a fixed order,
+so a sweep switches each channel once. The gateway runs the workers of the
+different buses in parallel: each one only touches its own I2CMaster.
+"""
+from itertools import groupby
+
+
+class BusWorker:
+    def __init__(self, i2c_master, devices):
+        self.i2c = i2c_master
+        # Directly wired nodes first, then mux by mux, channel by channel
+        ordered = sorted(devices, key=lambda d: (d.mux is not None, d.mux or 0, d.channel or 0))
+        self.groups = [((mux, channel), list(group))
+                       for (mux, channel), group in groupby(ordered, key=lambda d: (d.mux, d.channel))]
+
+    def sweep(self, due=None):
+        """Return [(device, events, lost)] for every node whose state changed.
+
+        due: set of the devices to poll, None for all of them.
+        """
+        changes = []
+        # Start from the channel left selected by the previous sweep
+        groups = self.groups
+        if groups and self.i2c.channel == groups[-1][0]:
+            groups = groups[::-1]
+        for (mux, channel), devices in groups:
+            if due is not None:
+                devices = [device for device in devices if device in due]
+                if not devices:
+                    continue
+            if not self.i2c.select_channel(mux, channel):
+                for device in devices:
+                    device.update(self.i2c, None)
+                continue
+
+            generations = self.i2c.read_generations(device.address for device in devices)
+            for device in devices:
+                if device.update(self.i2c, generations[device.address]):
+                    events, lost = device.drain_events(self.i2c)
+                    changes.append((device, events, lost))
+        return changes
+
+    def collect(self, read):
+        """Return [(device, read(i2c_master, device))] for every reachable node"""
+        results = []
+        for (mux, channel), devices in self.groups:
+            if self.i2c.select_channel(mux, channel):
+                results += [(device, read(self.i2c, device)) for device in devices]
+        return results
@@ -0,0 +1,123 @@
+"""Indexed event store (SQLite), fed by the Logger with each written batch.
+
+The JSON Lines segments stay the append-only record; this database answers
+queries ("what happened to OSC-01 last Tuesday") through its indexes on
+(device_id, timestamp), (event_type, timestamp) and timestamp, without
+loading the history in memory. Timestamps are the ISO 8601 strings of the
+log, which sort like the times they stand for.
+"""
+import datetime
+import os
+import sqlite3
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS events (
+    id          INTEGER PRIMARY KEY,
+    timestamp   TEXT NOT NULL,
+    event_type  TEXT NOT NULL,
+    device_id   TEXT,
+    device_name TEXT,
+    message     TEXT
+);
+CREATE INDEX IF NOT EXISTS events_device_time ON events (device_id, timestamp);
+CREATE INDEX IF NOT EXISTS events_type_time ON events (event_type, timestamp);
+CREATE INDEX IF NOT EXISTS events_time ON events (timestamp);
+"""
+
+
+class EventStore:
+    def __init__(self, path="data/events.db", retention_days=None):
+        """retention_days: events older than that are deleted once a day (None: kept)"""
+        self.path = os.path.join(SCRIPT_DIR, path)
+        self.retention_days = retention_days
+        self.purged_on = None
+        # Written from the Logger flush timer too, under the Logger lock
+        self.db = sqlite3.connect(self.path, check_same_thread=False)
+        self.db.row_factory = sqlite3.Row
+        # Before the first table: lets compact() give pages back to the file system
+        self.db.execute("PRAGMA auto_vacuum = INCREMENTAL")
+        self.db.execute("PRAGMA journal_mode = WAL")
+        self.db.execute("PRAGMA synchronous = NORMAL")
+        self.db.executescript(SCHEMA)
+
+    def is_empty(self):
+        return self.db.execute("SELECT 1 FROM events LIMIT 1").fetchone() is None
+
+    def insert_many(self, events):
+        """Insert a batch of logged events (dicts) in one transaction"""
+        with self.db:
+            self.db.executemany(
+                "INSERT INTO events (timestamp, event_type, device_id, device_name, message) "
+                "VALUES (:timestamp, :event_type, :device_id, :device_name, :message)",
+                ({key: event.get(key) for key in ("timestamp", "event_type", "device_id", "device_name", "message")}
+                 for event in events))
+        today = datetime.date.today()
+        if self.retention_days is not None and self.purged_on != today:
+            # The batch is committed: a failed purge must not make the caller insert it again
+            try:
+                self.purge(datetime.datetime.now() - datetime.timedelta(days=self.retention_days))
+                self.purged_on = today
+            except sqlite3.Error as e:
+                print(f"[EventStore] purge: {e}")
+
+    def import_events(self, events, batch=10000):
+        """Bulk load (history of the JSON Lines log), return the number of events"""
+        count = 0
+        chunk = []
+        for event in events:
+            chunk.append(event)
+            if len(chunk) == batch:
+                self.insert_many(chunk)
+                count += len(chunk)
+                chunk = []
+        self.insert_many(chunk)
+        return count + len(chunk)
+
+    def query(self, device_id=None, event_type=None, start=None, end=None, limit=1000):
+        """Events matching every given criterion, oldest first.
+
+        start/end: datetime or ISO string, start included, end excluded.
+        """
+        where, params = _where(device_id, event_type, start, end)
+        rows = self.db.execute(
+            f"SELECT timestamp, event_type, device_id, device_name, message FROM events {where} "
+            f"ORDER BY timestamp LIMIT ?", params + [limit])
+        return [dict(row) for row in rows]
+
+    def count_by_type(self, device_id=None, start=None, end=None):
+        """{event_type: count} over a period"""
+        where, params = _where(device_id, None, start, end)
+        rows = self.db.execute(f"SELECT event_type, COUNT(*) FROM events {where} GROUP BY event_type", params)
+        return dict(rows.fetchall())
+
+    def purge(self, before):
+        """Delete the events older than before, then compact; return how many were deleted"""
+        before = before.isoformat() if isinstance(before, datetime.datetime) else before
+        with self.db:
+            deleted = self.db.execute("DELETE FROM events WHERE timestamp < ?", (before,)).rowcount
+        if deleted:
+            self.compact()
+        return deleted
+
+    def compact(self):
+        """Give the free pages back to the file system"""
+        # executescript() steps the pragma to the end, execute() frees a single page
+        self.db.executescript("PRAGMA incremental_vacuum;")
+        self.db.execute("PRAGMA wal_checkpoint(TRUNCATE)")
+
+    def close(self):
+        self.db.close()
+
+
+def _where(device_id, event_type, start, end):
+    """WHERE clause and parameters of the given criteria (None: any)"""
+    clauses = []
+    params = []
+    for column, op, value in (("device_id", "=", device_id), ("event_type", "=", event_type),
+                              ("timestamp", ">=", start), ("timestamp", "<", end)):
+        if value is not None:
+            clauses.append(f"{column} {op} ?")
+            params.append(value.isoformat() if isinstance(value, datetime.datetime) else value)
+    return (f"WHERE {' AND '.join(clauses)}" if clauses else ""), params
@@ -1,62 +1,126 @@
+import datetime
 import time
-from arduino_device import STATUS_TAG_PRESENT, STATUS_TIMER_RUNNING, STATUS_ALARM_ACTIVE
+from concurrent.futures import ThreadPoolExecutor
+from bus_worker import BusWorker
+from poll_scheduler import PollScheduler
+from arduino_device import (EVENT_TAG_REMOVED, EVENT_TAG_RETURNED, EVENT_ALARM_STARTED,
+                            EVENT_ALARM_STOPPED, EVENT_ALARM_ACKED)
 
 class Gateway:
-    def __init__(self, i2c_master, arduino_devices, logger, notifier=None):
-        self.i2c = i2c_master
+    def __init__(self, i2c_masters, arduino_devices, logger, notifier=None):
+        """i2c_masters: {bus number: I2CMaster} for every bus used by the devices"""
         self.arduino_devices = arduino_devices
         self.logger = logger
         self.notifier = notifier
-        self.previous_states = {}
+        buses = sorted({device.bus for device in arduino_devices})
+        self.workers = [BusWorker(i2c_masters[bus], [d for d in arduino_devices if d.bus == bus])
+                        for bus in buses]
+        self.pool = ThreadPoolExecutor(max_workers=max(len(self.workers), 1), thread_name_prefix="i2c-bus")
 
-    def poll_all(self):
-        for device in self.arduino_devices:
-            device.poll(self.i2c)
-            
-    def _log_state_change(self, device, event_type, message):
-        self.logger.log(event_type, device.id, device.name, message)
-            
-    def check_state_changes(self):
-        """Check for state changes and log them"""
-        for device in self.arduino_devices:
-            current_status = device.last_status
-            previous_status = self.previous_states.get(device.id, None)
+    def _on_every_bus(self, work):
+        """Run work(worker) for all buses at once, concatenate the results"""
+        results = []
+        for future in [self.pool.submit(work, worker) for worker in self.workers]:
+            results += future.result()
+        return results
+
+    def poll_all(self, due=None):
+        """Return [(device, events, lost)] for the nodes whose state changed
+        since the previous poll. due: the devices to poll, None for all.
+
+        Each bus is swept by its own worker, concurrently. On a bus, the
+        generation counters of the nodes of a channel are read in batched
+        ioctls; only the nodes that changed are then read one by one.
+        """
+        due = set(due) if due is not None else None
+        return self._on_every_bus(lambda worker: worker.sweep(due))
             
-            # Skip if I2C read failed
-            if current_status is None:
+    # Node event type -> (log event type, message, notification or None)
+    EVENTS = {
+        EVENT_TAG_REMOVED: ("OBJECT_REMOVED", "Objet removed from its place", None),
+        EVENT_TAG_RETURNED: ("OBJECT_RETURNED", "Objet returned to its place", None),
+        EVENT_ALARM_STARTED: ("ALARM_STARTED", "Alarm started", "device missing, alarm started 🚨"),
+        EVENT_ALARM_STOPPED: ("ALARM_STOPPED", "Alarm stopped", "device returned, alarm stopped ✅"),
+        EVENT_ALARM_ACKED: ("ALARM_ACKNOWLEDGED", "Alarm stopped by the gateway", None),
+    }
+
+    def process_events(self, changes):
+        """Log and notify the events drained by poll_all()"""
+        now = datetime.datetime.now()
+        for device, events, lost in changes:
+            if lost:
+                self.logger.log("EVENTS_LOST", device.id, device.name, f"{lost} event(s) overwritten on the node")
+
+            for _, event_type, tag, age in events:
+                if event_type not in self.EVENTS:
+                    continue
+                log_type, message, notification = self.EVENTS[event_type]
+                tag_name = device.tag_name(tag)
+                if tag_name:
+                    # Node watching several tags: say which one
+                    message = f"{message} ({tag_name})"
+                    notification = notification and f"{tag_name} {notification}"
+                timestamp = now - datetime.timedelta(seconds=age)
+                self.logger.log(log_type, device.id, device.name, message, timestamp=timestamp)
+                if notification and self.notifier:
+                    self.notifier.notify(device.id, device.name, log_type, notification, timestamp=timestamp)
+
+    def collect_task_stats(self):
+        """Log the stack headroom and CPU share of every task on each node,
+        and the events posted to its logic task since boot"""
+        reports = self._on_every_bus(lambda worker: worker.collect(
+            lambda i2c, device: (device.poll_task_stats(i2c), i2c.read_event_signals(device.address))))
+        for device, (report, signals) in reports:
+            if report is None:
                 continue
-            
-            if previous_status is None:  # First poll
-                self.previous_states[device.id] = current_status
+
+            message = ", ".join(f"{name}: stack {free} free, cpu {share:.1%}" for name, free, share in report)
+            if signals is not None:
+                message += f"; events: {signals[0]} posted, {signals[1]} merged with a pending one"
+            self.logger.log("TASK_STATS", device.id, device.name, message)
+
+    def collect_bus_errors(self):
+        """Log the I2C errors seen by each node and by the gateway, when there are any"""
+        results = self._on_every_bus(lambda worker: worker.collect(
+            lambda i2c, device: (i2c.read_bus_errors(device.address), i2c.pec_error_count(device.address))))
+        for device, (counters, gateway_pec_errors) in results:
+            if counters is None or (counters == (0, 0) and gateway_pec_errors == 0):
                 continue
-            
-            if current_status != previous_status:
-                # Object returned (was not present, now present)
-                if not (previous_status & STATUS_TAG_PRESENT) and (current_status & STATUS_TAG_PRESENT):
-                    self._log_state_change(device, "OBJECT_RETURNED", "Objet returned to its place")
-                
-                # Object removed (was present, now not)
-                if (previous_status & STATUS_TAG_PRESENT) and not (current_status & STATUS_TAG_PRESENT):
-                    self._log_state_change(device, "OBJECT_REMOVED", "Objet removed from its place")
-                
-                # Alarm started
-                if not (previous_status & STATUS_ALARM_ACTIVE) and (current_status & STATUS_ALARM_ACTIVE):
-                    self._log_state_change(device, "ALARM_STARTED", "Alarm started")
-                    if self.notifier:
-                        self.notifier.notify(device.id, device.name, "ALARM_STARTED", "device missing, alarm started 🚨")
-                
-                # Alarm stopped
-                if (previous_status & STATUS_ALARM_ACTIVE) and not (current_status & STATUS_ALARM_ACTIVE):
-                    self._log_state_change(device, "ALARM_STOPPED", "Alarm stopped")
-                    if self.notifier:
-                        self.notifier.notify(device.id, device.name, "ALARM_STOPPED", "device returned, alarm stopped ✅")
-                
-                self.previous_states[device.id] = current_status
-    
-    def run(self, poll_interval_seconds=5):
+
+            pec_errors, bus_errors = counters
+            message = (f"node: {pec_errors} bad PEC on writes, {bus_errors} bus errors; "
+                       f"gateway: {gateway_pec_errors} bad PEC on reads")
+            self.logger.log("BUS_ERRORS", device.id, device.name, message)
+
+    def run(self, poll_interval_seconds=5, stats_interval_seconds=600, attention=None,
+            max_polls_per_second=200):
+        """Poll each node on its own deadline (see PollScheduler):
+        poll_interval_seconds for a quiet node, much faster while its timer
+        runs or its alarm rings. With an attention line, every node is also
+        polled as soon as one asserts it. max_polls_per_second caps the bus
+        time spent polling, over all buses."""
         print("Gateway running...")
         self.logger.log("SYSTEM", "GATEWAY", "Gateway", "Gateway running")
+        scheduler = PollScheduler(self.arduino_devices, time.monotonic(),
+                                  poll_interval_seconds, max_polls_per_second)
+        next_stats = time.monotonic()
         while True:
-            self.poll_all()
-            self.check_state_changes()
-            time.sleep(poll_interval_seconds)
\ No newline at end of file
+            due = scheduler.due(time.monotonic())
+            if due:
+                self.process_events(self.poll_all(due))
+                scheduler.reschedule(due, time.monotonic())
+            if time.monotonic() >= next_stats:
+                self.collect_task_stats()
+                self.collect_bus_errors()
+                next_stats += stats_interval_seconds
+
+            now = time.monotonic()
+            timeout = max(min(scheduler.next_wake(now), next_stats) - now, 0)
+            if attention is None:
+                time.sleep(timeout)
+            else:
+                # Still asserted after a sweep (failed read): do not spin on the bus
+                if attention.is_asserted():
+                    time.sleep(0.05)
+                if attention.wait(timeout):
+                    scheduler.wake_all(time.monotonic())
\ No newline at end of file
@@ -1,34 +1,444 @@
 import smbus2
 
 REG_STATUS = 0x00
+REG_SLEEP_STATS = 0x0B
+REG_GENERATION = 0x0F
 REG_COMMAND = 0x10
+REG_BUS_ERRORS = 0x11
+REG_EVENT_SIGNALS = 0x12
+REG_COMMAND_RESULT = 0x13
+REG_COMMAND_QUEUE = 0x14
+REG_TASK_STATS = 0x20
+REG_SNAPSHOT = 0x30
+REG_EVENT_COUNT = 0x40
+REG_EVENTS = 0x41
+REG_EVENT_ACK = 0x42
+REG_TAG_MAP = 0x50
+REG_TAG_PAGE = 0x60  # + tag index
+
+SNAPSHOT_SIZE = 16
+TAG_MAP_SIZE = 7
+TAG_PAGE_SIZE = 19
+COMMAND_RESULT_SIZE = 5
+
+EVENT_RECORD_SIZE = 5
+EVENT_DRAIN_MAX = 6
+TICK_WRAP = 1 << 16
+
+TASK_STATS_RECORD_SIZE = 6
+TASK_STATS_MAX_TASKS = 4
+
+# Most messages i2c-dev accepts in one I2C_RDWR ioctl (I2C_RDWR_IOCTL_MAX_MSGS)
+RDWR_MAX_MESSAGES = 42
 
 CMD_NOP = 0x00
 CMD_STOP_ALARM = 0x01
 
+CMD_RESULT_OK = 0x00
+CMD_RESULT_UNKNOWN = 0x01
+CMD_RESULT_BAD_ARGS = 0x02
+CMD_RESULT_NONE = 0xFF  # nothing executed since boot
+
+# Node command ring (COMMAND_RING_LENGTH) and write buffer without the register byte
+COMMAND_QUEUE_MAX = 4
+COMMAND_WRITE_MAX = 15
+COMMAND_ARGS_MAX = 4
+
+
+def _crc8_table():
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+        table.append(crc)
+    return table
+
+
+CRC8_TABLE = _crc8_table()
+
+
+def smbus_pec(data):
+    """SMBus Packet Error Code: CRC-8 (x^8 + x^2 + x + 1) of every byte of the transaction"""
+    crc = 0
+    for byte in data:
+        crc = CRC8_TABLE[crc ^ byte]
+    return crc
+
+
+class PecError(IOError):
+    pass
+
 
 class I2CMaster:
-    def __init__(self, bus_id=1):
-        self.bus = smbus2.SMBus(bus_id)
+    def __init__(self, bus_id=1, pec=False, retries=2, bus=None, muxes=()):
+        """pec: check the CRC-8 the nodes append to every read and protect
+        writes with it. retries: extra attempts after a PEC or bus error.
+        bus: object standing for smbus2.SMBus(bus_id) (mock bus).
+        muxes: addresses of the TCA9548A multiplexers on this bus."""
+        self.bus = bus if bus is not None else smbus2.SMBus(bus_id)
+        self.pec = pec
+        self.retries = retries
+        self.muxes = list(muxes)
+        # (mux address, channel) the bus is routed to, None while unknown
+        self.channel = None if self.muxes else (None, None)
+        # Keyed by (mux address, channel, address): nodes behind different
+        # multiplexer channels may share an address
+        self.pec_errors = {}  # node -> PEC errors seen on reads
+        self.unbatched = set()  # nodes that stopped answering, kept out of batched reads
+        self.command_seq = {}  # node -> last sequence number given to a command
+
+    def _node(self, address):
+        return (self.channel or (None, None)) + (address,)
+
+    def select_channel(self, mux_address, channel):
+        """Route the bus to one TCA9548A channel, or to the nodes wired
+        directly when mux_address is None. Nothing is written if the bus is
+        already routed there; any other mux is left with all channels off,
+        so nodes sharing an address never answer together.
+
+        Return False if a multiplexer did not answer.
+        """
+        target = (mux_address, channel)
+        if self.channel == target:
+            return True
+
+        if self.channel is None:
+            to_clear = [mux for mux in self.muxes if mux != mux_address]
+        elif self.channel[0] not in (None, mux_address):
+            to_clear = [self.channel[0]]
+        else:
+            to_clear = []
+
+        try:
+            for mux in to_clear:
+                self.bus.write_byte(mux, 0x00)
+            if mux_address is not None:
+                self.bus.write_byte(mux_address, 1 << channel)
+        except OSError as e:
+            self.channel = None
+            print(f"Error while switching I2C mux to {mux_address}/{channel}: {e}")
+            return False
+        self.channel = target
+        return True
+
+    def pec_error_count(self, address):
+        """PEC errors seen on reads of this node (behind the selected channel)"""
+        return self.pec_errors.get(self._node(address), 0)
+
+    def _read_block(self, address, register, length):
+        """Read a register block, checking its PEC; raise after the last attempt"""
+        for attempt in range(self.retries + 1):
+            try:
+                if not self.pec:
+                    return self.bus.read_i2c_block_data(address, register, length)
+
+                data = self._check_pec(address, register, self.bus.read_i2c_block_data(address, register, length + 1))
+                if data is not None:
+                    return data
+                error = PecError(f"bad PEC on register 0x{register:02X}")
+            except OSError as e:
+                error = e
+        raise error
+
+    def _check_pec(self, address, register, data):
+        """Strip and check the PEC byte of a register read, None (and counted) if wrong"""
+        if not self.pec:
+            return data
+        if smbus_pec([address << 1, register, (address << 1) | 1] + data[:-1]) == data[-1]:
+            return data[:-1]
+        node = self._node(address)
+        self.pec_errors[node] = self.pec_errors.get(node, 0) + 1
+        return None
 
     def read_status(self, arduino_address):
         try:
-            return self.bus.read_byte_data(arduino_address, REG_STATUS)
+            return self._read_block(arduino_address, REG_STATUS, 1)[0]
+        except Exception as e:
+            print(f"Error while reading I2C 0x{arduino_address:02X}: {e}")
+            return None
+
+    def read_snapshot(self, address):
+        """Read status, tag ID, timer and event counter in one consistent block"""
+        try:
+            data = self._read_block(address, REG_SNAPSHOT, SNAPSHOT_SIZE)
         except Exception as e:
-            print(f"Error while reading I2C 0x{arduino_address}: {e}")
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return None
+
+        return {
+            "status": data[0],
+            "seq": data[1],
+            "tag_id": bytes(data[2:10]).split(b"\0", 1)[0].decode("ascii", "replace"),
+            "timer_left": (data[10] << 8) | data[11],
+            "event_count": (data[12] << 8) | data[13],
+            "generation": (data[14] << 8) | data[15],
+        }
+
+    def read_tag_map(self, address):
+        """Return (count, present, timer, alarm): one bit per tag of the node table"""
+        try:
+            data = self._read_block(address, REG_TAG_MAP, TAG_MAP_SIZE)
+        except Exception as e:
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return None
+        return data[0], (data[1] << 8) | data[2], (data[3] << 8) | data[4], (data[5] << 8) | data[6]
+
+    def read_tag_page(self, address, index):
+        """State, name, ages and card ID of one tag of the node table"""
+        try:
+            data = self._read_block(address, REG_TAG_PAGE + index, TAG_PAGE_SIZE)
+        except Exception as e:
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return None
+        return {
+            "index": data[0],
+            "flags": data[1],
+            "name": bytes(data[2:10]).split(b"\0", 1)[0].decode("ascii", "replace"),
+            "seen_age": (data[10] << 8) | data[11],
+            "timer_left": (data[12] << 8) | data[13],
+            "card_id": bytes(data[14:19]).hex().upper(),
+        }
+
+    def read_generation(self, address):
+        """Counter bumped by the node on every change of its published state"""
+        try:
+            data = self._read_block(address, REG_GENERATION, 2)
+            return (data[0] << 8) | data[1]
+        except Exception as e:
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return None
+
+    def read_generations(self, addresses):
+        """Read REG_GENERATION of many nodes in as few ioctls as possible.
+
+        Return {address: generation or None}. One I2C_RDWR call chains, with
+        repeated STARTs, the register write and the read of up to 21 nodes.
+        A node that NACKs fails the whole call: its group is then read node
+        by node, as is a single node whose PEC is wrong. A node that still
+        does not answer is read on its own until it comes back.
+        """
+        addresses = list(dict.fromkeys(addresses))
+        batch = [address for address in addresses if self._node(address) not in self.unbatched]
+        length = 3 if self.pec else 2
+        per_call = RDWR_MAX_MESSAGES // 2
+        generations = {}
+        for start in range(0, len(batch), per_call):
+            group = batch[start:start + per_call]
+            if len(group) == 1:
+                # Nothing to batch: the SMBus call is cheaper than building messages
+                generations[group[0]] = self.read_generation(group[0])
+                continue
+            reads = [smbus2.i2c_msg.read(address, length) for address in group]
+            messages = []
+            for address, read in zip(group, reads):
+                messages += [smbus2.i2c_msg.write(address, [REG_GENERATION]), read]
+            try:
+                self.bus.i2c_rdwr(*messages)
+                results = [self._check_pec(address, REG_GENERATION, list(read)) for address, read in zip(group, reads)]
+            except OSError:
+                results = [None] * len(group)
+
+            for address, data in zip(group, results):
+                if data is None:
+                    generations[address] = self.read_generation(address)
+                    if generations[address] is None:
+                        self.unbatched.add(self._node(address))
+                else:
+                    generations[address] = (data[0] << 8) | data[1]
+
+        for address in addresses:
+            if self._node(address) in self.unbatched and address not in generations:
+                generations[address] = self.read_generation(address)
+                if generations[address] is not None:
+                    self.unbatched.discard(self._node(address))
+        return generations
+
+    def _ack_events(self, address, seq):
+        """Remove the node records up to seq, once read and checked"""
+        for attempt in range(self.retries + 1):
+            try:
+                if self.pec:
+                    pec = smbus_pec([address << 1, REG_EVENT_ACK, seq])
+                    self.bus.write_i2c_block_data(address, REG_EVENT_ACK, [seq, pec])
+                else:
+                    self.bus.write_byte_data(address, REG_EVENT_ACK, seq)
+                return
+            except OSError as e:
+                error = e
+        raise error
+
+    def read_events(self, address):
+        """Drain the node event FIFO.
+
+        Return a list of (seq, type, tag, age_seconds), oldest first, or None
+        if the node did not answer. The node keeps its records until the
+        gateway acknowledges the last seq it read with a valid PEC, so a
+        block with a bad PEC is read again like any other register. If an
+        acknowledgement is lost the records come back on the next drain
+        (same seq numbers).
+        """
+        events = []
+        try:
+            count, tick_hz, tick_hi, tick_lo = self._read_block(address, REG_EVENT_COUNT, 4)
+            now = (tick_hi << 8) | tick_lo
+            while count > 0:
+                n = min(count, EVENT_DRAIN_MAX)
+                data = self._read_block(address, REG_EVENTS, n * EVENT_RECORD_SIZE)
+                records = []
+                for i in range(0, len(data), EVENT_RECORD_SIZE):
+                    seq, event_type, tag, hi, lo = data[i:i + EVENT_RECORD_SIZE]
+                    age = ((now - ((hi << 8) | lo)) % TICK_WRAP) / tick_hz
+                    records.append((seq, event_type, tag, age))
+                self._ack_events(address, records[-1][0])
+                events += records
+                count -= n
+        except Exception as e:
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return events or None
+        return events
+
+    def read_sleep_stats(self, address):
+        """Return (tick_count, sleep_ticks), both 16-bit counters that wrap"""
+        try:
+            data = self._read_block(address, REG_SLEEP_STATS, 4)
+            return (data[0] << 8) | data[1], (data[2] << 8) | data[3]
+        except Exception as e:
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return None
+
+    def read_task_stats(self, address):
+        """Return (run_time, [(stack_free_words, task_run_time), ...]).
+
+        Tasks are ReadTag, Logic, timer task, idle task. Run times are
+        32-bit counters that wrap (16 us per count on the node).
+        """
+        try:
+            length = 5 + TASK_STATS_MAX_TASKS * TASK_STATS_RECORD_SIZE
+            data = self._read_block(address, REG_TASK_STATS, length)
+        except Exception as e:
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return None
+
+        count = min(data[0], TASK_STATS_MAX_TASKS)
+        run_time = int.from_bytes(bytes(data[1:5]), "big")
+        tasks = []
+        for i in range(count):
+            record = data[5 + i * TASK_STATS_RECORD_SIZE:5 + (i + 1) * TASK_STATS_RECORD_SIZE]
+            tasks.append(((record[0] << 8) | record[1], int.from_bytes(bytes(record[2:6]), "big")))
+        return run_time, tasks
+
+    def read_bus_errors(self, address):
+        """Return (pec_errors, bus_errors) counted by the node since boot"""
+        try:
+            data = self._read_block(address, REG_BUS_ERRORS, 4)
+            return (data[0] << 8) | data[1], (data[2] << 8) | data[3]
+        except Exception as e:
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return None
+
+    def read_event_signals(self, address):
+        """Return (posted, merged): events signalled to the node logic task since
+        boot, and how many arrived while the same event was still pending.
+        A merged event is not lost (the node re-reads its tag table), but a
+        growing count means the logic task falls behind."""
+        try:
+            data = self._read_block(address, REG_EVENT_SIGNALS, 4)
+            return (data[0] << 8) | data[1], (data[2] << 8) | data[3]
+        except Exception as e:
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
             return None
 
     def send_command(self, address, command):
+        """The node drops a command whose PEC does not match (counted in REG_BUS_ERRORS)"""
+        for attempt in range(self.retries + 1):
+            try:
+                if self.pec:
+                    pec = smbus_pec([address << 1, REG_COMMAND, command])
+                    self.bus.write_i2c_block_data(address, REG_COMMAND, [command, pec])
+                else:
+                    self.bus.write_byte_data(address, REG_COMMAND, command)
+                return True
+            except Exception as e:
+                error = e
+        print(f"Error while writing I2C 0x{address:02X}: {error}")
+        return False
+
+    def _next_command_seq(self, address):
+        # 0 is left to the commands written to REG_COMMAND. The node skips a
+        # seq just before the last one it ran (a retried write): numbering
+        # goes on from that one after a gateway restart.
+        node = self._node(address)
+        if node not in self.command_seq:
+            result = self.read_command_result(address)
+            self.command_seq[node] = result["seq"] if result else 0
+        seq = self.command_seq[node] % 255 + 1
+        self.command_seq[node] = seq
+        return seq
+
+    def send_commands(self, address, commands):
+        """Queue several commands on the node in as few writes as possible.
+
+        commands: list of (command, args) with up to 4 argument bytes. Each
+        write carries up to 4 [seq, command, argc, args] records, which the
+        node runs in order. Return the sequence numbers given to the
+        commands, or None if a write failed. A retried write keeps its
+        sequence numbers, and the node does not run again a command it
+        already ran; read_command_result() tells what was executed.
+        """
+        records = []
+        for command, args in commands:
+            args = list(args)
+            if len(args) > COMMAND_ARGS_MAX:
+                raise ValueError(f"command 0x{command:02X} has more than {COMMAND_ARGS_MAX} arguments")
+            records.append([self._next_command_seq(address), command, len(args)] + args)
+
+        limit = COMMAND_WRITE_MAX - (1 if self.pec else 0)
+        writes = []
+        for record in records:
+            if writes and len(writes[-1]) < COMMAND_QUEUE_MAX and sum(map(len, writes[-1])) + len(record) <= limit:
+                writes[-1].append(record)
+            else:
+                writes.append([record])
+
+        for write in writes:
+            data = [byte for record in write for byte in record]
+            if self.pec:
+                data.append(smbus_pec([address << 1, REG_COMMAND_QUEUE] + data))
+            for attempt in range(self.retries + 1):
+                try:
+                    self.bus.write_i2c_block_data(address, REG_COMMAND_QUEUE, data)
+                    break
+                except Exception as e:
+                    error = e
+            else:
+                print(f"Error while writing I2C 0x{address:02X}: {error}")
+                return None
+        return [record[0] for record in records]
+
+    def read_command_result(self, address):
+        """Return {seq, result, queued, dropped}: the last command the node
+        executed and its CMD_RESULT_*, the commands it holds but has not run
+        yet, and the commands lost on a full queue since boot. A command is
+        done once seq reached its number and queued is 0."""
         try:
-            self.bus.write_byte_data(address, REG_COMMAND, command)
-            return True
+            data = self._read_block(address, REG_COMMAND_RESULT, COMMAND_RESULT_SIZE)
         except Exception as e:
-            print(f"Error while writing I2C 0x{address:02X}: {e}")
-            return False
+            print(f"Error while reading I2C 0x{address:02X}: {e}")
+            return None
+        return {
+            "seq": data[0],
+            "result": data[1],
+            "queued": data[2],
+            "dropped": (data[3] << 8) | data[4],
+        }
 
-    def stop_alarm(self, address):
+    def stop_alarm(self, address, tag=None):
+        """Acknowledge the alarm of one tag (index in the node table), or of
+        every tag. Return the command sequence number, None on failure."""
         # TODO: implement a timeout of alarm and send a stop alarm command, and then the email
-        return self.send_command(address, CMD_STOP_ALARM)
+        seqs = self.send_commands(address, [(CMD_STOP_ALARM, [] if tag is None else [tag])])
+        return seqs[0] if seqs else None
 
     def close(self):
         self.bus.close()
@@ -0,0 +1,75 @@
+"""Event log throughput: JSON Lines logger against the old JSON array file.
+
+Usage: python3 log_benchmark.py [--events 100000] [--legacy-events 1000]
+
+Runs in a temporary directory. The old format rewrites the whole file on
+every event (O(n^2) over a run), so it is measured on fewer events and its
+time for --events is extrapolated quadratically.
+"""
+import argparse
+import datetime
+import json
+import os
+import tempfile
+import time
+from logger import Logger, read_log
+
+
+def legacy_log(path, event):
+    """What Logger.log did before the JSON Lines format"""
+    try:
+        with open(path, "r") as f:
+            events = json.load(f)
+    except (json.JSONDecodeError, FileNotFoundError):
+        events = []
+    events.append(event)
+    with open(path, "w") as f:
+        json.dump(events, f, indent=2)
+
+
+def event(i):
+    return {
+        "timestamp": datetime.datetime.now().isoformat(),
+        "event_type": "OBJECT_REMOVED" if i % 2 else "OBJECT_RETURNED",
+        "device_id": f"OSC-{i % 64:02d}",
+        "device_name": "Oscilloscope",
+        "message": "Objet removed from its place",
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--events", type=int, default=100000)
+    parser.add_argument("--legacy-events", type=int, default=1000)
+    parser.add_argument("--max-bytes", type=int, default=4 * 1024 * 1024, help="segment size")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as directory:
+        legacy_path = os.path.join(directory, "legacy.json")
+        start = time.perf_counter()
+        for i in range(args.legacy_events):
+            legacy_log(legacy_path, event(i))
+        legacy = time.perf_counter() - start
+
+        log_file = os.path.join(directory, "events.jsonl")
+        logger = Logger(log_file, os.path.join(directory, "none.json"), max_bytes=args.max_bytes, echo=False)
+        start = time.perf_counter()
+        for i in range(args.events):
+            e = event(i)
+            logger.log(e["event_type"], e["device_id"], e["device_name"], e["message"])
+        logger.flush()
+        jsonl = time.perf_counter() - start
+        logger.close()
+
+        read = sum(1 for _ in read_log(log_file, os.path.join(directory, "none.json")))
+        segments = len(os.listdir(directory)) - 1
+
+    scaled = legacy * (args.events / args.legacy_events) ** 2
+    print(f"JSON array: {args.legacy_events} events in {legacy:.2f} s "
+          f"({args.legacy_events / legacy:,.0f}/s), ~{scaled:,.0f} s extrapolated to {args.events}")
+    print(f"JSON Lines: {args.events} events in {jsonl:.2f} s ({args.events / jsonl:,.0f}/s), "
+          f"{segments} segment(s), {read} read back")
+
+
+if __name__ == "__main__":
+    main()
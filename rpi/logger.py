@@ -1,22 +1,81 @@
+"""Append-only event log, one JSON object per line (JSON Lines).
+
+Events are buffered and written in batches, with one fsync per batch: when
+the buffer is full, when the oldest buffered event is flush_seconds old, or
+at once for alarm events. A crash loses at most the buffered events and can
+only truncate the last line, which the readers skip.
+
+The active segment is data/events.jsonl. It is closed when it reaches
+max_bytes or when the day changes, renamed events-<date>-<n>.jsonl and
+compressed to .jsonl.gz in the background.
+
+Each written batch is also inserted, in one transaction, into the indexed
+EventStore given as store (see event_store.py). A batch the store refused
+is kept and inserted again with the next batch, up to max_store_pending
+events.
+"""
+import atexit
 import datetime
+import glob
+import gzip
 import json
 import os
+import shutil
+import sqlite3
+import threading
+import time
 
 SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
 
+# Written to disk as soon as logged
+IMMEDIATE_EVENTS = ("ALARM_STARTED", "ALARM_STOPPED", "ALARM_ACKNOWLEDGED")
+
+
 class Logger:
-    def __init__(self, log_file="data/events.json"):
+    def __init__(self, log_file="data/events.jsonl", legacy_file="data/events.json",
+                 max_buffer=256, flush_seconds=5.0, max_bytes=10 * 1024 * 1024, echo=True, store=None,
+                 max_store_pending=16384):
         self.log_file = os.path.join(SCRIPT_DIR, log_file)
-        self._ensure_file_exists()
+        self.store = store
+        self.directory = os.path.dirname(self.log_file)
+        self.max_buffer = max_buffer
+        self.flush_seconds = flush_seconds
+        self.max_bytes = max_bytes
+        self.echo = echo
+        self.buffer = []
+        self.buffer_since = None
+        self.max_store_pending = max_store_pending
+        self.store_pending = []  # written to the log, not yet in the store
+        self._flush_timer = None
+        self._lock = threading.Lock()  # the flush timer runs on its own thread
+        self._compressing = []
+
+        os.makedirs(self.directory, exist_ok=True)
+        self._migrate(os.path.join(SCRIPT_DIR, legacy_file))
+        # Segments closed but not compressed before the last stop
+        for path in self._closed_segments():
+            self._compress_later(path)
+        if store is not None and store.is_empty():
+            # New store: index the history already on disk
+            count = store.import_events(read_log(self.log_file, legacy_file))
+            if count:
+                print(f"[Logger] {count} event(s) imported into {store.path}")
+        self._open()
+        atexit.register(self.close)
 
-    def _ensure_file_exists(self):
-        if not os.path.exists(self.log_file) or os.path.getsize(self.log_file) == 0:
-            with open(self.log_file, "w") as f:
-                json.dump([], f)
+    def _open(self):
+        self.file = open(self.log_file, "a", encoding="utf-8")
+        self.size = self.file.tell()
+        if self.size and not ends_with_newline(self.log_file):
+            # Line truncated by a crash: the next event must start a line of its own
+            self.file.write("\n")
+            self.size += 1
+        self.day = (datetime.date.fromtimestamp(os.path.getmtime(self.log_file))
+                    if self.size else datetime.date.today())
+
+    def log(self, event_type, device_id, device_name, message, timestamp=None):
+        timestamp = (timestamp or datetime.datetime.now()).isoformat()
 
-    def log(self, event_type, device_id, device_name, message):
-        timestamp = datetime.datetime.now().isoformat()
-        
         event = {
             "timestamp": timestamp,
             "event_type": event_type,
@@ -24,15 +83,157 @@ class Logger:
             "device_name": device_name,
             "message": message
         }
-        
-        print(f"[{timestamp}] {event_type}: {device_name} - {message}")
-        
+
+        if self.echo:
+            print(f"[{timestamp}] {event_type}: {device_name} - {message}")
+
+        with self._lock:
+            self.buffer.append(event)
+            if self.buffer_since is None:
+                self.buffer_since = time.monotonic()
+                # Quiet period after this event: written flush_seconds later anyway
+                self._flush_timer = threading.Timer(self.flush_seconds, self.flush)
+                self._flush_timer.daemon = True
+                self._flush_timer.start()
+            if (event_type in IMMEDIATE_EVENTS or len(self.buffer) >= self.max_buffer
+                    or time.monotonic() - self.buffer_since >= self.flush_seconds):
+                self._write()
+
+    def flush(self):
+        """Write the buffered events and fsync them"""
+        with self._lock:
+            self._write()
+
+    def _write(self):
+        if self.buffer:
+            self._flush_timer.cancel()
+            data = "".join(json.dumps(event, ensure_ascii=False) + "\n" for event in self.buffer)
+            if self.size and (self.size + len(data) > self.max_bytes or datetime.date.today() != self.day):
+                self._rotate()
+            self.file.write(data)
+            self.file.flush()
+            os.fsync(self.file.fileno())
+            self.size += len(data.encode("utf-8"))
+            if self.store is not None:
+                self.store_pending += self.buffer
+            self.buffer = []
+            self.buffer_since = None
+        if self.store_pending:
+            self._insert_pending()
+
+    def _insert_pending(self):
+        """Insert the batches the store has not taken yet, in one transaction"""
         try:
-            with open(self.log_file, "r") as f:
-                events = json.load(f)
-        except (json.JSONDecodeError, FileNotFoundError):
-            events = []
-        
-        events.append(event)
-        with open(self.log_file, "w") as f:
-            json.dump(events, f, indent=2)
\ No newline at end of file
+            self.store.insert_many(self.store_pending)
+            self.store_pending = []
+        except sqlite3.Error as e:
+            # The JSON Lines file stays the reference: retried with the next batch
+            dropped = len(self.store_pending) - self.max_store_pending
+            if dropped > 0:
+                self.store_pending = self.store_pending[dropped:]
+                print(f"[Logger] event store: {e}; {dropped} event(s) only in the log, "
+                      f"delete {self.store.path} to import the whole log again")
+            else:
+                print(f"[Logger] event store: {e}; {len(self.store_pending)} event(s) kept for the next flush")
+
+    def _rotate(self):
+        self.file.close()
+        stem = os.path.join(self.directory, f"events-{self.day.isoformat()}")
+        n = 1
+        while glob.glob(f"{stem}-{n}.jsonl*"):
+            n += 1
+        closed = f"{stem}-{n}.jsonl"
+        os.rename(self.log_file, closed)
+        self._compress_later(closed)
+        self._open()
+
+    def _closed_segments(self):
+        return sorted(glob.glob(os.path.join(self.directory, "events-*.jsonl")))
+
+    def _compress_later(self, path):
+        thread = threading.Thread(target=compress_segment, args=(path,), daemon=True)
+        thread.start()
+        self._compressing = [t for t in self._compressing if t.is_alive()] + [thread]
+
+    def _migrate(self, legacy_path):
+        """Move the events of the old JSON array file into a closed segment"""
+        events = list(read_legacy(legacy_path))
+        if not events:
+            return
+        day = events[0].get("timestamp", "")[:10] or datetime.date.today().isoformat()
+        closed = os.path.join(self.directory, f"events-{day}-0.jsonl")
+        with open(closed, "w", encoding="utf-8") as f:
+            for event in events:
+                f.write(json.dumps(event, ensure_ascii=False) + "\n")
+            f.flush()
+            os.fsync(f.fileno())
+        # Emptied, not removed: the placeholder file is tracked by git
+        open(legacy_path, "w").close()
+        print(f"[Logger] {len(events)} event(s) migrated from {legacy_path}")
+
+    def close(self):
+        with self._lock:
+            self._write()
+            self.file.close()
+            if self.store is not None:
+                self.store.close()
+        for thread in self._compressing:
+            thread.join()
+
+
+def compress_segment(path):
+    """Replace a closed segment by its .gz, never leaving a partial archive"""
+    tmp = path + ".gz.tmp"
+    with open(path, "rb") as src, gzip.open(tmp, "wb") as dst:
+        shutil.copyfileobj(src, dst)
+    os.replace(tmp, path + ".gz")
+    os.remove(path)
+
+
+def ends_with_newline(path):
+    """False when the last line of a non-empty file was cut by a crash"""
+    with open(path, "rb") as f:
+        f.seek(-1, os.SEEK_END)
+        return f.read(1) == b"\n"
+
+
+def read_legacy(path):
+    """Events of the old format: one JSON array rewritten on every event"""
+    try:
+        with open(path, encoding="utf-8") as f:
+            return json.load(f)
+    except (FileNotFoundError, json.JSONDecodeError):
+        return []
+
+
+def read_segment(path):
+    """Events of one segment (.jsonl or .jsonl.gz); a truncated line is skipped"""
+    opener = gzip.open if path.endswith(".gz") else open
+    with opener(path, "rt", encoding="utf-8") as f:
+        for line in f:
+            try:
+                yield json.loads(line)
+            except json.JSONDecodeError:
+                continue
+
+
+def read_log(log_file="data/events.jsonl", legacy_file="data/events.json"):
+    """Every logged event, oldest segment first, old array format included"""
+    log_file = os.path.join(SCRIPT_DIR, log_file)
+    yield from read_legacy(os.path.join(SCRIPT_DIR, legacy_file))
+    segments = {}
+    for path in sorted(glob.glob(os.path.join(os.path.dirname(log_file), "events-*.jsonl*"))):
+        # A segment being compressed exists twice: the .gz, sorted last, wins
+        if path.endswith((".jsonl", ".jsonl.gz")):
+            segments[path.removesuffix(".gz")] = path
+    for key in sorted(segments, key=segment_order):
+        yield from read_segment(segments[key])
+    if os.path.exists(log_file):
+        yield from read_segment(log_file)
+
+
+def segment_order(path):
+    """events-<date>-<n>.jsonl: by date, then n (numerically)"""
+    name = os.path.basename(path)[len("events-"):-len(".jsonl")]
+    day, _, n = name.rpartition("-")
+    return day, int(n) if n.isdigit() else 0
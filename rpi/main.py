@@ -4,7 +4,9 @@ from i2c_master import I2CMaster
 from arduino_device import ArduinoDevice
 from gateway import Gateway
 from logger import Logger
+from event_store import EventStore
 from notifier import Notifier
+from attention import open_attention_line
 
 SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
 
@@ -14,29 +16,55 @@ def load_config(filepath="data/arduinos_config.json"):
         return json.load(f)
 
 def arduino_devices_init(config):
+    default_bus = config.get("i2c", {}).get("bus", 1)
     devices = []
+    locations = set()
     for d in config["devices"]:
-        devices.append(ArduinoDevice(
+        device = ArduinoDevice(
             id=d["id"],
             name=d["name"],
             address=d["address"],
             timeout_minutes=d["timeout_minutes"],
-            toalert_email=config["alerts"]["email"]
-        ))
+            toalert_email=config["alerts"]["email"],
+            bus=d.get("bus", default_bus),
+            mux=d.get("mux"),
+            channel=d.get("channel")
+        )
+        if device.location() in locations:
+            raise ValueError(f"{device.id}: another device uses bus/mux/channel/address {device.location()}")
+        locations.add(device.location())
+        devices.append(device)
     return devices
 
+def i2c_masters_init(config, devices):
+    """One I2CMaster per bus used by the devices, with the muxes found on it"""
+    pec = config.get("i2c", {}).get("pec", False)
+    masters = {}
+    for bus in sorted({d.bus for d in devices}):
+        muxes = sorted({d.mux for d in devices if d.bus == bus and d.mux is not None})
+        masters[bus] = I2CMaster(bus, pec=pec, muxes=muxes)
+    return masters
+
 def main():
     config = load_config()
     
-    i2c = I2CMaster(1)
-    logger = Logger()
+    store_config = config.get("event_store", {})
+    store = EventStore(store_config.get("path", "data/events.db"), store_config.get("retention_days"))
+    logger = Logger(store=store)
     notifier = Notifier(config)
     devices = arduino_devices_init(config)
+    i2c_masters = i2c_masters_init(config, devices)
     
-    gateway = Gateway(i2c, devices, logger, notifier)
+    gateway = Gateway(i2c_masters, devices, logger, notifier)
+    attention = open_attention_line(config.get("attention"))
+    polling = config.get("polling", {})
+    # With the attention line, quiet nodes are polled blindly only once a
+    # minute, in case an edge is missed
+    idle_seconds = polling.get("idle_seconds", 5 if attention is None else 60)
     
-    print(f"Gateway started with {len(devices)} device(s)")
-    gateway.run(poll_interval_seconds=5)
+    print(f"Gateway started with {len(devices)} device(s) on {len(i2c_masters)} bus(es)")
+    gateway.run(poll_interval_seconds=idle_seconds, attention=attention,
+                max_polls_per_second=polling.get("max_polls_per_second", 200))
 
 if __name__ == "__main__":
     main()
\ No newline at end of file
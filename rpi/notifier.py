@@ -1,70 +1,214 @@
+"""Alarm notifications, sent by a background worker.
+
+notify() only queues: the poll loop never waits on the network. The worker
+sends the notifications one at a time, in order (so per device too):
+
+- a network error or a 5xx is retried with exponential backoff;
+- HTTP 429 waits for Retry-After (header, or retry_after in Discord's body);
+- after MAX_ATTEMPTS failures the endpoint is considered unreachable: the
+  pending notifications are spooled to disk and retried from there, also
+  after a restart;
+- any other 4xx is dropped (the request itself is wrong).
+
+Spooled notifications are always older than the queued ones; the worker
+sends the spool first.
+"""
+import atexit
+import collections
 import json
-import urllib.request
+import os
+import random
+import threading
 import urllib.error
+import urllib.request
 from datetime import datetime
 
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+DEFAULT_DISCORD_WEBHOOK = "https://discord.com/api/webhooks/1457082272866898050/3tt51DZ-Wr58TC_fGOE853yjEbJ9oi661oCHvCj-GJ4qxwmX2uwGL-cck6vbcxe-7bsN"
+NOTIFIED_EVENTS = ("ALARM_STARTED", "ALARM_STOPPED")
+
+MAX_ATTEMPTS = 3  # failures in a row before spooling
+BACKOFF_SECONDS = 1.0
+BACKOFF_MAX_SECONDS = 300.0
+
+SENT, DROPPED, RETRY, RATE_LIMITED = range(4)
+
 
 class Notifier:
-    def __init__(self, config):
-        self.discord_webhook = "https://discord.com/api/webhooks/1457082272866898050/3tt51DZ-Wr58TC_fGOE853yjEbJ9oi661oCHvCj-GJ4qxwmX2uwGL-cck6vbcxe-7bsN"
-        print(f"[Notifier] Discord: {'Configured' if self.discord_webhook else 'Not configured'}")
+    def __init__(self, config, webhook=None, spool_file="data/notifications.spool", max_queue=100, timeout=10):
+        self.discord_webhook = webhook or config.get("alerts", {}).get("discord", DEFAULT_DISCORD_WEBHOOK)
+        self.spool_file = os.path.join(SCRIPT_DIR, spool_file)
+        self.max_queue = max_queue
+        self.timeout = timeout
+        self.queue = collections.deque()
+        self.lock = threading.Condition()
+        self.stopping = threading.Event()
+        self.spooled = len(self._read_spool())
+        print(f"[Notifier] Discord: {'Configured' if self.discord_webhook else 'Not configured'}"
+              + (f", {self.spooled} notification(s) spooled" if self.spooled else ""))
+
+        self.worker = threading.Thread(target=self._run, name="notifier", daemon=True)
+        self.worker.start()
+        atexit.register(self.close)
+
+    def notify(self, device_id, device_name, event_type, message, timestamp=None):
+        """Queue a notification for every configured channel, without blocking.
 
-    
-    # =========================================================================
-    # DISCORD WEBHOOK
-    # =========================================================================
-    
-    def _send_discord(self, device_id, device_name, event_type, message):
-        """Send a notification to Discord via webhook"""
-        if not self.discord_webhook:
-            return False
-        
-        try:
-            # Parse timestamp for date and time
-            dt = datetime.now()
-            date_str = dt.strftime("%Y-%m-%d")
-            time_str = dt.strftime("%H:%M:%S")
-            
-            payload = {
-                "content": f"**ALARM**\n**Device:** {device_name} ({device_id})\n**On:** {date_str}\n**At:** {time_str}\n**Message:** {message}"
-            }
-            data = json.dumps(payload).encode('utf-8')
-            req = urllib.request.Request(
-                self.discord_webhook, 
-                data=data, 
-                headers={
-                    'Content-Type': 'application/json',
-                    'User-Agent': 'LaboGateway/1.0'
-                }
-            )
-            
-            response = urllib.request.urlopen(req, timeout=10)
-            if response.getcode() in [200, 204]:
-                print(f"[Notifier] Discord notification sent")
-                return True
-            else:
-                print(f"[Notifier] Discord notification failed, code: {response.getcode()}")
-                return False
-        except Exception as e:
-            print(f"[Notifier] Discord notification failed: {e}")
-            return False
-    
-    def notify(self, device_id, device_name, event_type, message):
-        """
-        Envoie une notification vers tous les canaux configurés
-        
         Args:
             device_id: Identifiant de l'équipement (ex: "OSC-01")
             device_name: Nom lisible (ex: "Oscilloscope new gen")
             event_type: Type d'événement (ex: "ALARM_STARTED")
             message: Message descriptif
+            timestamp: Heure de l'événement (par défaut : maintenant)
+
+        Return True if the notification was queued.
         """
-        results = {
-            "discord": False
+        if not self.discord_webhook or event_type not in NOTIFIED_EVENTS:
+            return False
+
+        notification = {
+            "device_id": device_id,
+            "device_name": device_name,
+            "event_type": event_type,
+            "message": message,
+            "timestamp": (timestamp or datetime.now()).isoformat(),
         }
-        
-        # Envoyer via Discord
-        if self.discord_webhook and event_type in ["ALARM_STARTED", "ALARM_STOPPED"]:
-            results["discord"] = self._send_discord(device_id, device_name, event_type, message)
-        
-        return results
\ No newline at end of file
+        with self.lock:
+            if len(self.queue) >= self.max_queue:
+                # Queue full: everything goes to disk, order kept
+                self._spill([notification])
+            else:
+                self.queue.append(notification)
+            self.lock.notify()
+        return True
+
+    # =========================================================================
+    # WORKER
+    # =========================================================================
+
+    def _run(self):
+        failures = 0
+        while not self.stopping.is_set():
+            with self.lock:
+                while not self.spooled and not self.queue and not self.stopping.is_set():
+                    self.lock.wait()
+                if self.stopping.is_set():
+                    return
+                from_spool = self.spooled > 0
+                notification = self._read_spool()[0] if from_spool else self.queue[0]
+
+            result, delay = self._send_discord(notification)
+            if result == RATE_LIMITED:
+                self.stopping.wait(delay)
+                continue
+            if result == RETRY:
+                failures += 1
+                if failures >= MAX_ATTEMPTS and not from_spool:
+                    with self.lock:
+                        self._spill([])
+                # Jitter: several gateways do not retry in step
+                delay = min(BACKOFF_SECONDS * 2 ** (failures - 1), BACKOFF_MAX_SECONDS)
+                self.stopping.wait(delay * random.uniform(0.8, 1.2))
+                continue
+
+            failures = 0
+            with self.lock:
+                if from_spool:
+                    self._write_spool(self._read_spool()[1:])
+                else:
+                    self.queue.popleft()
+
+    def _spill(self, newest):
+        """Append the queue, then newest, to the spool (lock held)"""
+        pending = list(self.queue) + newest
+        self.queue.clear()
+        with open(self.spool_file, "a", encoding="utf-8") as f:
+            for notification in pending:
+                f.write(json.dumps(notification, ensure_ascii=False) + "\n")
+            f.flush()
+            os.fsync(f.fileno())
+        self.spooled += len(pending)
+        print(f"[Notifier] {len(pending)} notification(s) spooled to disk")
+
+    def _read_spool(self):
+        try:
+            with open(self.spool_file, encoding="utf-8") as f:
+                return [json.loads(line) for line in f if line.strip()]
+        except FileNotFoundError:
+            return []
+
+    def _write_spool(self, notifications):
+        """Replace the spool atomically (lock held)"""
+        tmp = self.spool_file + ".tmp"
+        with open(tmp, "w", encoding="utf-8") as f:
+            for notification in notifications:
+                f.write(json.dumps(notification, ensure_ascii=False) + "\n")
+            f.flush()
+            os.fsync(f.fileno())
+        os.replace(tmp, self.spool_file)
+        self.spooled = len(notifications)
+
+    def close(self):
+        """Stop the worker; notifications not sent yet are spooled for the next start"""
+        self.stopping.set()
+        with self.lock:
+            self.lock.notify()
+        self.worker.join(self.timeout + 1)
+        with self.lock:
+            if self.queue:
+                self._spill([])
+
+    # =========================================================================
+    # DISCORD WEBHOOK
+    # =========================================================================
+
+    def _send_discord(self, notification):
+        """Send a notification to Discord via webhook, return (result, retry delay)"""
+        dt = datetime.fromisoformat(notification["timestamp"])
+        date_str = dt.strftime("%Y-%m-%d")
+        time_str = dt.strftime("%H:%M:%S")
+
+        payload = {
+            "content": f"**ALARM**\n**Device:** {notification['device_name']} ({notification['device_id']})\n"
+                       f"**On:** {date_str}\n**At:** {time_str}\n**Message:** {notification['message']}"
+        }
+        data = json.dumps(payload).encode('utf-8')
+        req = urllib.request.Request(
+            self.discord_webhook,
+            data=data,
+            headers={
+                'Content-Type': 'application/json',
+                'User-Agent': 'LaboGateway/1.0'
+            }
+        )
+
+        try:
+            with urllib.request.urlopen(req, timeout=self.timeout):
+                print(f"[Notifier] Discord notification sent")
+                return SENT, 0
+        except urllib.error.HTTPError as e:
+            if e.code == 429:
+                delay = retry_after(e)
+                print(f"[Notifier] Discord rate limit, retrying in {delay:.1f} s")
+                return RATE_LIMITED, delay
+            if e.code >= 500:
+                print(f"[Notifier] Discord notification failed, code: {e.code}")
+                return RETRY, 0
+            print(f"[Notifier] Discord notification rejected, code: {e.code}, dropped")
+            return DROPPED, 0
+        except (urllib.error.URLError, OSError) as e:
+            print(f"[Notifier] Discord notification failed: {e}")
+            return RETRY, 0
+
+
+def retry_after(error):
+    """Seconds to wait after a 429: Retry-After header, else Discord's JSON body"""
+    try:
+        return max(float(error.headers.get("Retry-After")), 0.0)
+    except (TypeError, ValueError):
+        pass
+    try:
+        return max(float(json.loads(error.read())["retry_after"]), 0.0)
+    except (ValueError, KeyError, TypeError):
+        return BACKOFF_SECONDS
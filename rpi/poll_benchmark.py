@@ -0,0 +1,109 @@
+"""Compare the sweep time of per-node and batched polling on a mock bus.
+
+Usage: python3 poll_benchmark.py [--syscall-us 150] [--clock 100000] [--pec] [--absent]
+
+The mock bus answers like the nodes (REG_GENERATION, PEC) and charges each
+ioctl a fixed system call cost plus the wire time of its bytes at the bus
+clock, by busy-waiting, so the Python overhead of each path is measured too.
+--absent makes the last node NACK, to time the per-node fallback.
+"""
+import argparse
+import contextlib
+import ctypes
+import errno
+import io
+import time
+from i2c_master import I2CMaster, REG_GENERATION, smbus_pec
+
+I2C_M_RD = 0x0001
+
+
+class MockBus:
+    """Stands for smbus2.SMBus: nodes 0x08.. with a fixed generation counter"""
+
+    def __init__(self, node_count, syscall_us, clock_hz, pec, absent=()):
+        self.nodes = {0x08 + i: 0x0100 + i for i in range(node_count)}
+        for address in absent:
+            self.nodes.pop(address, None)
+        self.syscall_s = syscall_us / 1e6
+        self.bit_s = 1.0 / clock_hz
+        self.pec = pec
+        self.ioctls = 0
+
+    def _spend(self, wire_bytes):
+        # 9 clocks per byte (ACK included) plus START/STOP
+        end = time.perf_counter() + self.syscall_s + (wire_bytes * 9 + 2) * self.bit_s
+        while time.perf_counter() < end:
+            pass
+
+    def _register(self, address, register, length):
+        if register == REG_GENERATION:
+            generation = self.nodes[address]
+            data = [generation >> 8, generation & 0xFF]
+        else:
+            data = [0] * (length - 1 if self.pec else length)
+        if self.pec:
+            data.append(smbus_pec([address << 1, register, (address << 1) | 1] + data))
+        return (data + [0] * length)[:length]
+
+    def read_i2c_block_data(self, address, register, length):
+        self.ioctls += 1
+        self._spend(3 + length)
+        if address not in self.nodes:
+            raise OSError(errno.EREMOTEIO, "Remote I/O error")
+        return self._register(address, register, length)
+
+    def i2c_rdwr(self, *messages):
+        self.ioctls += 1
+        self._spend(sum(1 + message.len for message in messages))
+        register = None
+        for message in messages:
+            if message.addr not in self.nodes:
+                raise OSError(errno.EREMOTEIO, "Remote I/O error")
+            if message.flags & I2C_M_RD:
+                data = bytes(self._register(message.addr, register, message.len))
+                ctypes.memmove(message.buf, data, len(data))
+            else:
+                register = list(message)[0]
+
+
+def sweep_time(i2c, addresses, batched, rounds):
+    # Silence the read errors printed for an absent node
+    with contextlib.redirect_stdout(io.StringIO()):
+        start = time.perf_counter()
+        for _ in range(rounds):
+            if batched:
+                generations = i2c.read_generations(addresses)
+            else:
+                generations = {address: i2c.read_generation(address) for address in addresses}
+    return (time.perf_counter() - start) / rounds, generations
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--syscall-us", type=float, default=150.0, help="cost of one ioctl (Python and kernel)")
+    parser.add_argument("--clock", type=int, default=100000, help="bus clock in Hz")
+    parser.add_argument("--rounds", type=int, default=20)
+    parser.add_argument("--pec", action="store_true")
+    parser.add_argument("--absent", action="store_true", help="last node does not answer")
+    args = parser.parse_args()
+
+    print(f"{'nodes':>5}  {'per node':>10}  {'batched':>10}  {'speedup':>7}  {'ioctls':>11}")
+    for count in (1, 2, 4, 8, 16, 32, 64):
+        addresses = [0x08 + i for i in range(count)]
+        absent = addresses[-1:] if args.absent else ()
+        times = []
+        ioctls = []
+        for batched in (False, True):
+            bus = MockBus(count, args.syscall_us, args.clock, args.pec, absent)
+            i2c = I2CMaster(pec=args.pec, retries=0, bus=bus)
+            elapsed, generations = sweep_time(i2c, addresses, batched, args.rounds)
+            assert all(generations[a] == bus.nodes.get(a) for a in addresses)
+            times.append(elapsed)
+            ioctls.append(bus.ioctls // args.rounds)
+        print(f"{count:>5}  {times[0] * 1e3:>8.2f}ms  {times[1] * 1e3:>8.2f}ms  "
+              f"{times[0] / times[1]:>6.1f}x  {ioctls[0]:>4} -> {ioctls[1]:<4}")
+
+
+if __name__ == "__main__":
+    main()
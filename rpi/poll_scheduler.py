@@ -0,0 +1,71 @@
+"""Per-device poll deadlines, kept in a priority queue.
+
+Each node is polled again after an interval chosen from its last observed
+state: a ringing alarm or a running timer gets sub-second attention, a quiet
+node waits the idle interval, a node that does not answer backs off. A token
+bucket caps the polls per second over all buses; when more nodes are due
+than the budget allows, the most overdue ones go first.
+"""
+import heapq
+import itertools
+
+POLL_ALARM_SECONDS = 0.5
+POLL_TIMER_SECONDS = 1.0
+POLL_RETRY_MAX_SECONDS = 60.0
+
+
+class PollScheduler:
+    def __init__(self, devices, now, idle_seconds=5.0, max_polls_per_second=200.0):
+        """idle_seconds: interval of a node with no timer, alarm or error.
+        max_polls_per_second: bus budget, one poll being a generation read."""
+        self.idle_seconds = idle_seconds
+        self.rate = max_polls_per_second
+        self.burst = max(max_polls_per_second, 1.0)
+        self.tokens = self.burst
+        self.refilled = now
+        self._order = itertools.count()  # ties: configuration order
+        self.heap = [(now, next(self._order), device) for device in devices]
+        heapq.heapify(self.heap)
+
+    def interval(self, device):
+        """Seconds until the next poll of this node, from its state"""
+        if device.failures:
+            return min(self.idle_seconds * 2 ** (device.failures - 1), max(POLL_RETRY_MAX_SECONDS, self.idle_seconds))
+        if device.is_alarm_active():
+            return POLL_ALARM_SECONDS
+        if device.is_timer_running():
+            return POLL_TIMER_SECONDS
+        return self.idle_seconds
+
+    def _refill(self, now):
+        self.tokens = min(self.burst, self.tokens + (now - self.refilled) * self.rate)
+        self.refilled = now
+
+    def due(self, now):
+        """Pop the nodes whose deadline has passed, within the bus budget"""
+        self._refill(now)
+        devices = []
+        while self.heap and self.heap[0][0] <= now and self.tokens >= 1:
+            devices.append(heapq.heappop(self.heap)[2])
+            self.tokens -= 1
+        return devices
+
+    def reschedule(self, devices, now):
+        """Put polled nodes back, each at the interval of its new state"""
+        for device in devices:
+            heapq.heappush(self.heap, (now + self.interval(device), next(self._order), device))
+
+    def wake_all(self, now):
+        """Make every node due now (a node asserted the attention line)"""
+        self.heap = [(min(deadline, now), order, device) for deadline, order, device in self.heap]
+        heapq.heapify(self.heap)
+
+    def next_wake(self, now):
+        """Time of the next due() call worth making"""
+        if not self.heap:
+            return now + self.idle_seconds
+        deadline = self.heap[0][0]
+        if deadline <= now and self.tokens < 1:
+            # Over budget: wait for the next token
+            return now + (1 - self.tokens) / self.rate
+        return deadline
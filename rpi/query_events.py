@@ -0,0 +1,54 @@
+"""Query the indexed event store.
+
+Usage examples:
+    python3 query_events.py --device OSC-01 --since 2025-01-07 --until 2025-01-08
+    python3 query_events.py --type ALARM_STARTED --since 2025-01-01 --count
+    python3 query_events.py --purge-days 365
+
+Dates are ISO 8601 (YYYY-MM-DD or YYYY-MM-DDTHH:MM:SS), local time like the
+log; --since is included, --until excluded.
+"""
+import argparse
+import datetime
+import json
+import time
+from event_store import EventStore
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--db", default="data/events.db")
+    parser.add_argument("--device", help="device id")
+    parser.add_argument("--type", help="event type (OBJECT_REMOVED, ALARM_STARTED...)")
+    parser.add_argument("--since")
+    parser.add_argument("--until")
+    parser.add_argument("--limit", type=int, default=1000)
+    parser.add_argument("--count", action="store_true", help="count per event type instead of listing")
+    parser.add_argument("--json", action="store_true", help="one JSON object per line")
+    parser.add_argument("--purge-days", type=int, help="delete the events older than this many days")
+    args = parser.parse_args()
+
+    store = EventStore(args.db)
+    start = time.perf_counter()
+
+    if args.purge_days is not None:
+        before = datetime.datetime.now() - datetime.timedelta(days=args.purge_days)
+        print(f"{store.purge(before)} event(s) deleted")
+    elif args.count:
+        for event_type, count in sorted(store.count_by_type(args.device, args.since, args.until).items()):
+            print(f"{event_type:<20} {count}")
+    else:
+        for event in store.query(args.device, args.type, args.since, args.until, args.limit):
+            if args.json:
+                print(json.dumps(event, ensure_ascii=False))
+            else:
+                print(f"[{event['timestamp']}] {event['event_type']}: "
+                      f"{event['device_name']} ({event['device_id']}) - {event['message']}")
+
+    if not args.json:
+        print(f"({(time.perf_counter() - start) * 1e3:.1f} ms)")
+    store.close()
+
+
+if __name__ == "__main__":
+    main()
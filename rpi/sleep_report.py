@@ -0,0 +1,45 @@
+"""Print the fraction of time each node spent asleep (tickless idle).
+
+Usage: python3 sleep_report.py [interval_seconds]
+
+The interval must stay below 655 s: the node counters are 16-bit ticks
+(10 ms) and wrap after that.
+"""
+import sys
+import time
+from main import load_config, arduino_devices_init, i2c_masters_init
+
+TICK_WRAP = 1 << 16
+
+
+def main():
+    interval = float(sys.argv[1]) if len(sys.argv) > 1 else 10.0
+    config = load_config()
+    devices = arduino_devices_init(config)
+    i2c_masters = i2c_masters_init(config, devices)
+
+    def read(d):
+        i2c = i2c_masters[d.bus]
+        return i2c.read_sleep_stats(d.address) if i2c.select_channel(d.mux, d.channel) else None
+
+    first = {d.id: read(d) for d in devices}
+    time.sleep(interval)
+
+    for d in devices:
+        start = first[d.id]
+        end = read(d)
+        if start is None or end is None:
+            print(f"{d.id}: no answer")
+            continue
+
+        ticks = (end[0] - start[0]) % TICK_WRAP
+        asleep = (end[1] - start[1]) % TICK_WRAP
+        ratio = asleep / ticks if ticks else 0.0
+        print(f"{d.id}: asleep {ratio:.1%} of {ticks * 10} ms")
+
+    for i2c in i2c_masters.values():
+        i2c.close()
+
+
+if __name__ == "__main__":
+    main()
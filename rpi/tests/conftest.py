@@ -0,0 +1,5 @@
+"""The gateway modules import each other by name, as when run from rpi/"""
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
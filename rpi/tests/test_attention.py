@@ -0,0 +1,26 @@
+import threading
+
+from attention import MockAttentionLine, open_attention_line
+from poll_scheduler import PollScheduler
+from test_poll_scheduler import devices
+
+
+def test_mock_line_from_the_config():
+    assert open_attention_line(None) is None
+    assert isinstance(open_attention_line({"mock": True}), MockAttentionLine)
+
+
+def test_attention_edge_wakes_the_scheduler():
+    nodes = devices(2)
+    scheduler = PollScheduler(nodes, 0.0, idle_seconds=5.0)
+    scheduler.reschedule(scheduler.due(0.0), 0.0)
+    line = MockAttentionLine()
+
+    assert not line.wait(0.01)
+    threading.Timer(0.05, line.assert_line).start()
+    assert line.wait(5.0)  # returns on the edge, not after the timeout
+    scheduler.wake_all(0.1)
+    assert scheduler.due(0.1) == nodes
+
+    line.release()
+    assert not line.is_asserted()
@@ -0,0 +1,160 @@
+import datetime
+import glob
+import json
+import os
+import sqlite3
+
+import pytest
+
+from logger import Logger, read_log, read_segment
+
+
+class FakeStore:
+    """EventStore stand-in; refuse makes the next inserts fail"""
+
+    path = "events.db"
+
+    def __init__(self, refuse=0):
+        self.refuse = refuse
+        self.events = []
+        self.closed = False
+
+    def is_empty(self):
+        return False
+
+    def insert_many(self, events):
+        if self.refuse:
+            self.refuse -= 1
+            raise sqlite3.OperationalError("database is locked")
+        self.events += events
+
+    def close(self):
+        self.closed = True
+
+
+@pytest.fixture
+def paths(tmp_path):
+    return str(tmp_path / "events.jsonl"), str(tmp_path / "events.json")
+
+
+def make_logger(paths, **kwargs):
+    log_file, legacy_file = paths
+    return Logger(log_file, legacy_file, echo=False, **kwargs)
+
+
+def messages(events):
+    return [event["message"] for event in events]
+
+
+def test_buffered_until_flush(paths):
+    log = make_logger(paths, flush_seconds=60)
+    log.log("OBJECT_REMOVED", "OSC-01", "Scope", "one")
+    assert os.path.getsize(paths[0]) == 0
+    log.flush()
+    assert messages(read_segment(paths[0])) == ["one"]
+    log.close()
+
+
+def test_alarm_written_at_once(paths):
+    log = make_logger(paths, flush_seconds=60)
+    log.log("OBJECT_REMOVED", "OSC-01", "Scope", "removed")
+    log.log("ALARM_STARTED", "OSC-01", "Scope", "alarm")
+    assert messages(read_segment(paths[0])) == ["removed", "alarm"]
+    log.close()
+
+
+def test_full_buffer_is_written(paths):
+    log = make_logger(paths, flush_seconds=60, max_buffer=3)
+    for i in range(3):
+        log.log("OBJECT_REMOVED", "OSC-01", "Scope", str(i))
+    assert messages(read_segment(paths[0])) == ["0", "1", "2"]
+    log.close()
+
+
+def test_rotation_by_size_keeps_every_event(paths):
+    log = make_logger(paths, flush_seconds=60, max_bytes=400)
+    for i in range(20):
+        log.log("ALARM_STARTED", "OSC-01", "Scope", str(i))
+    log.close()  # waits for the compression threads
+
+    directory = os.path.dirname(paths[0])
+    assert glob.glob(os.path.join(directory, "events-*.jsonl.gz"))
+    assert not glob.glob(os.path.join(directory, "events-*.jsonl"))
+    assert os.path.getsize(paths[0]) <= 400
+    assert messages(read_log(*paths)) == [str(i) for i in range(20)]
+
+
+def test_rotation_at_day_change(paths):
+    log = make_logger(paths, flush_seconds=60)
+    log.log("ALARM_STARTED", "OSC-01", "Scope", "yesterday")
+    yesterday = log.day - datetime.timedelta(days=1)
+    log.day = yesterday
+    log.log("ALARM_STARTED", "OSC-01", "Scope", "today")
+    log.close()
+
+    directory = os.path.dirname(paths[0])
+    assert glob.glob(os.path.join(directory, f"events-{yesterday.isoformat()}-1.jsonl.gz"))
+    assert messages(read_segment(paths[0])) == ["today"]
+    assert messages(read_log(*paths)) == ["yesterday", "today"]
+
+
+def test_truncated_last_line_is_skipped(paths):
+    log = make_logger(paths)
+    log.log("ALARM_STARTED", "OSC-01", "Scope", "complete")
+    log.close()
+    with open(paths[0], "a", encoding="utf-8") as f:
+        f.write('{"timestamp": "2025-01-07T10:')  # crash in the middle of a write
+
+    assert messages(read_log(*paths)) == ["complete"]
+
+
+def test_event_after_a_truncated_line_is_kept(paths):
+    with open(paths[0], "w", encoding="utf-8") as f:
+        f.write(json.dumps({"message": "before"}) + "\n" + '{"timestamp": "2025-01-07T10:')
+
+    log = make_logger(paths)  # restart after the crash
+    log.log("ALARM_STARTED", "OSC-01", "Scope", "after")
+    log.close()
+
+    assert messages(read_log(*paths)) == ["before", "after"]
+
+
+def test_legacy_array_is_migrated(paths):
+    legacy = [{"timestamp": "2025-01-06T09:00:00", "event_type": "SYSTEM", "message": "old"}]
+    with open(paths[1], "w", encoding="utf-8") as f:
+        json.dump(legacy, f)
+
+    log = make_logger(paths)
+    log.log("ALARM_STARTED", "OSC-01", "Scope", "new")
+    log.close()
+
+    assert os.path.getsize(paths[1]) == 0
+    assert messages(read_log(*paths)) == ["old", "new"]
+
+
+def test_refused_batch_is_inserted_with_the_next_one(paths):
+    store = FakeStore(refuse=1)
+    log = make_logger(paths, store=store)
+    log.log("ALARM_STARTED", "OSC-01", "Scope", "first")
+    assert store.events == []
+    assert messages(log.store_pending) == ["first"]
+
+    log.log("ALARM_STOPPED", "OSC-01", "Scope", "second")
+    assert messages(store.events) == ["first", "second"]
+    assert log.store_pending == []
+    log.close()
+    assert store.closed
+
+
+def test_store_backlog_is_bounded(paths, capsys):
+    store = FakeStore(refuse=3)
+    log = make_logger(paths, store=store, max_store_pending=2)
+    for message in ("a", "b", "c"):
+        log.log("ALARM_STARTED", "OSC-01", "Scope", message)
+    assert messages(log.store_pending) == ["b", "c"]
+    assert "1 event(s) only in the log" in capsys.readouterr().out
+
+    log.log("ALARM_STARTED", "OSC-01", "Scope", "d")
+    assert messages(store.events) == ["b", "c", "d"]
+    assert messages(read_log(*paths)) == ["a", "b", "c", "d"]  # the log has everything
+    log.close()
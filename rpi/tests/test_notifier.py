@@ -0,0 +1,122 @@
+import json
+import socket
+import time
+
+import pytest
+
+import notifier as notifier_module
+from notifier import Notifier
+from webhook_standin import serve
+
+
+@pytest.fixture(autouse=True)
+def fast_backoff(monkeypatch):
+    monkeypatch.setattr(notifier_module, "BACKOFF_SECONDS", 0.05)
+
+
+@pytest.fixture
+def spool(tmp_path):
+    return str(tmp_path / "notifications.spool")
+
+
+def standin(**kwargs):
+    server, received = serve(port=0, **kwargs)
+    return server, received, f"http://127.0.0.1:{server.server_address[1]}/"
+
+
+def closed_port_url():
+    with socket.socket() as s:
+        s.bind(("127.0.0.1", 0))
+        port = s.getsockname()[1]
+    return f"http://127.0.0.1:{port}/"
+
+
+def wait_for(condition, timeout=10.0):
+    deadline = time.monotonic() + timeout
+    while not condition():
+        if time.monotonic() > deadline:
+            return False
+        time.sleep(0.01)
+    return True
+
+
+def notify(notifier, *messages):
+    for message in messages:
+        assert notifier.notify("OSC-01", "Scope", "ALARM_STARTED", message)
+
+
+def sent(received):
+    return [content.rsplit("**Message:** ", 1)[1] for content in received]
+
+
+def spooled(path):
+    with open(path, encoding="utf-8") as f:
+        return [json.loads(line)["message"] for line in f]
+
+
+def test_other_events_are_not_notified(spool):
+    notifier = Notifier({}, webhook=closed_port_url(), spool_file=spool, timeout=1)
+    assert not notifier.notify("OSC-01", "Scope", "OBJECT_REMOVED", "removed")
+    notifier.close()
+
+
+def test_notify_does_not_wait_for_the_endpoint(spool):
+    server, received, url = standin(slow=1.0)
+    notifier = Notifier({}, webhook=url, spool_file=spool, timeout=5)
+    start = time.monotonic()
+    notify(notifier, "1", "2", "3")
+    assert time.monotonic() - start < 0.1
+    assert wait_for(lambda: len(received) == 3)
+    assert sent(received) == ["1", "2", "3"]
+    notifier.close()
+    server.shutdown()
+
+
+def test_server_errors_are_retried_in_order(spool):
+    server, received, url = standin(fail=2)
+    notifier = Notifier({}, webhook=url, spool_file=spool, timeout=1)
+    notify(notifier, "1", "2", "3")
+    assert wait_for(lambda: len(received) == 3)
+    assert sent(received) == ["1", "2", "3"]
+    assert notifier.spooled == 0
+    notifier.close()
+    server.shutdown()
+
+
+def test_rate_limit_waits_for_retry_after(spool):
+    server, received, url = standin(rate_limit=2)  # every 2nd request: 429, Retry-After: 1
+    notifier = Notifier({}, webhook=url, spool_file=spool, timeout=1)
+    start = time.monotonic()
+    notify(notifier, "1", "2")
+    assert wait_for(lambda: len(received) == 2)
+    assert time.monotonic() - start >= 0.9
+    assert sent(received) == ["1", "2"]
+    notifier.close()
+    server.shutdown()
+
+
+def test_unreachable_endpoint_spools_then_sends_after_restart(spool):
+    notifier = Notifier({}, webhook=closed_port_url(), spool_file=spool, timeout=1)
+    notify(notifier, "1", "2")
+    assert wait_for(lambda: notifier.spooled == 2)
+    notify(notifier, "3")
+    notifier.close()  # still queued: spooled after the others
+    assert spooled(spool) == ["1", "2", "3"]
+
+    server, received, url = standin()
+    notifier = Notifier({}, webhook=url, spool_file=spool, timeout=1)
+    notify(notifier, "4")
+    assert wait_for(lambda: len(received) == 4)
+    assert sent(received) == ["1", "2", "3", "4"]
+    assert notifier.spooled == 0
+    assert spooled(spool) == []
+    notifier.close()
+    server.shutdown()
+
+
+def test_full_queue_goes_to_the_spool(spool):
+    notifier = Notifier({}, webhook=closed_port_url(), spool_file=spool, timeout=1, max_queue=2)
+    notify(notifier, "1", "2", "3")  # nothing leaves the queue while the endpoint is down
+    assert list(notifier.queue) == []
+    assert spooled(spool) == ["1", "2", "3"]
+    notifier.close()
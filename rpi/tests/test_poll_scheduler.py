@@ -0,0 +1,93 @@
+from poll_scheduler import POLL_ALARM_SECONDS, POLL_RETRY_MAX_SECONDS, POLL_TIMER_SECONDS, PollScheduler
+
+
+class FakeDevice:
+    def __init__(self, name, timer=False, alarm=False, failures=0):
+        self.name = name
+        self.timer = timer
+        self.alarm = alarm
+        self.failures = failures
+
+    def is_timer_running(self):
+        return self.timer
+
+    def is_alarm_active(self):
+        return self.alarm
+
+    def __repr__(self):
+        return self.name
+
+
+def devices(count):
+    return [FakeDevice(f"node-{i}") for i in range(count)]
+
+
+def test_interval_follows_the_state():
+    scheduler = PollScheduler([], 0.0, idle_seconds=5.0)
+    assert scheduler.interval(FakeDevice("quiet")) == 5.0
+    assert scheduler.interval(FakeDevice("timer", timer=True)) == POLL_TIMER_SECONDS
+    assert scheduler.interval(FakeDevice("alarm", timer=True, alarm=True)) == POLL_ALARM_SECONDS
+    assert scheduler.interval(FakeDevice("down", failures=1)) == 5.0
+    assert scheduler.interval(FakeDevice("down", failures=3)) == 20.0
+    assert scheduler.interval(FakeDevice("down", failures=30)) == POLL_RETRY_MAX_SECONDS
+
+
+def test_reschedule_puts_hot_nodes_first():
+    quiet, timer, alarm = FakeDevice("quiet"), FakeDevice("timer", timer=True), FakeDevice("alarm", alarm=True)
+    scheduler = PollScheduler([quiet, timer, alarm], 0.0, idle_seconds=5.0)
+    scheduler.reschedule(scheduler.due(0.0), 0.0)
+
+    assert scheduler.due(0.4) == []
+    assert scheduler.next_wake(0.4) == POLL_ALARM_SECONDS
+    assert scheduler.due(0.5) == [alarm]
+    assert scheduler.due(1.0) == [timer]
+    assert scheduler.due(4.9) == []
+    assert scheduler.due(5.0) == [quiet]
+
+
+def test_token_budget_caps_the_polls():
+    nodes = devices(300)
+    scheduler = PollScheduler(nodes, 0.0, max_polls_per_second=200.0)
+
+    first = scheduler.due(0.0)
+    assert first == nodes[:200]  # configuration order on equal deadlines
+    assert scheduler.due(0.0) == []
+    assert scheduler.next_wake(0.0) == 1 / 200.0  # next token
+
+    assert scheduler.due(0.25) == nodes[200:250]
+    assert scheduler.due(1.0) == nodes[250:]
+
+
+def test_over_budget_the_most_overdue_go_first():
+    late, later = FakeDevice("late"), FakeDevice("later")
+    scheduler = PollScheduler([], 0.0, max_polls_per_second=1.0)
+    scheduler.reschedule([later], -4.0)  # due at 1.0
+    scheduler.reschedule([late], -5.0)   # due at 0.0
+    scheduler.tokens = 0
+
+    assert scheduler.due(1.0) == [late]
+    assert scheduler.due(1.0) == []
+    assert scheduler.due(2.0) == [later]
+
+
+def test_wake_all_makes_every_node_due():
+    nodes = devices(3)
+    scheduler = PollScheduler(nodes, 0.0, idle_seconds=5.0)
+    scheduler.reschedule(scheduler.due(0.0), 0.0)
+    assert scheduler.due(1.0) == []
+
+    scheduler.wake_all(1.0)
+    assert scheduler.next_wake(1.0) == 1.0
+    assert scheduler.due(1.0) == nodes
+
+
+def test_wake_all_keeps_overdue_deadlines():
+    early, late = FakeDevice("early"), FakeDevice("late")
+    scheduler = PollScheduler([], 0.0, idle_seconds=5.0, max_polls_per_second=1.0)
+    scheduler.reschedule([late], 0.0)    # due at 5.0
+    scheduler.reschedule([early], -10.0)  # due at -5.0, not polled yet
+    scheduler.tokens = 1
+
+    scheduler.wake_all(1.0)
+    assert scheduler.due(1.0) == [early]
+
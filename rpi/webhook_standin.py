@@ -0,0 +1,78 @@
+"""Local stand-in for the Discord webhook, to exercise the notifier.
+
+Usage: python3 webhook_standin.py [--port 8099] [--fail 3] [--rate-limit 2] [--slow 5]
+
+Point the gateway at it with "alerts": {"discord": "http://127.0.0.1:8099/"}.
+--fail N answers 500 to the first N requests, --rate-limit K answers 429
+(Retry-After: 1) to every K-th request, --slow S waits S seconds before
+answering. Every accepted message is printed.
+"""
+import argparse
+import json
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+def make_handler(fail, rate_limit, slow, received):
+    counter = {"requests": 0}
+    lock = threading.Lock()
+
+    class Handler(BaseHTTPRequestHandler):
+        def do_POST(self):
+            body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+            with lock:
+                counter["requests"] += 1
+                n = counter["requests"]
+            time.sleep(slow)
+
+            if n <= fail:
+                self.send_response(500)
+                self.end_headers()
+                return
+            if rate_limit and n % rate_limit == 0:
+                self.send_response(429)
+                self.send_header("Retry-After", "1")
+                self.send_header("Content-Type", "application/json")
+                self.end_headers()
+                self.wfile.write(b'{"retry_after": 1.0}')
+                return
+
+            content = json.loads(body)["content"]
+            received.append(content)
+            print(f"--- request {n}\n{content}")
+            self.send_response(204)
+            self.end_headers()
+
+        def log_message(self, format, *args):
+            pass
+
+    return Handler
+
+
+def serve(port=8099, fail=0, rate_limit=0, slow=0.0):
+    """Start the server in a thread, return (server, list of received contents)"""
+    received = []
+    server = ThreadingHTTPServer(("127.0.0.1", port), make_handler(fail, rate_limit, slow, received))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server, received
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8099)
+    parser.add_argument("--fail", type=int, default=0)
+    parser.add_argument("--rate-limit", type=int, default=0)
+    parser.add_argument("--slow", type=float, default=0.0)
+    args = parser.parse_args()
+
+    server, _ = serve(args.port, args.fail, args.rate_limit, args.slow)
+    print(f"Webhook stand-in on http://127.0.0.1:{args.port}/")
+    try:
+        threading.Event().wait()
+    except KeyboardInterrupt:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -8,24 +8,43 @@
 #define RFID_RX_PIN 2
 #define RFID_TX_PIN 3
 
-/* Target RFID tag ID to monitor */
-#define TAG_TARGET "OSC-01"
+/* RFID tags monitored by the node: the "allowed_tags" of the node in
+   rpi/data/arduinos_config.json, compiled into drivers/tags/tag_hash.h by
+   tools/gen_tag_hash.py (make NODE=<device id>). 16 tags at most. */
+
+/* Tag declared missing after this long without a valid frame */
+#define TAG_ABSENCE_TIMEOUT_MS 1000
 
 /* Time allowed before alarm triggers */
 #define SECURITY_TIMEOUT_MS 6000
 
 
+/* WDT tick build: reset if the idle task has not run for this long (max 255 ticks) */
+#define WATCHDOG_STALL_TIMEOUT_MS 2000
+
+
 /* Task Priorities */
 #define TASK_SENSOR_PRIORITY (tskIDLE_PRIORITY + 3)  /* High */
 #define TASK_LOGIC_PRIORITY  (tskIDLE_PRIORITY + 2)  /* Middle */
-#define TASK_ALARM_PRIORITY  (tskIDLE_PRIORITY + 1)  /* Low */
+
+/* Task stack sizes (in words) */
+#define TASK_SENSOR_STACK_SIZE 85
+#define TASK_LOGIC_STACK_SIZE  90
 
 // FreeRTOS Configuration Parameters
 
 #define configCPU_CLOCK_HZ          ((unsigned long)16000000) /* CPU Frequency (Arduino Uno = 16MHz) */
+#ifdef WDT_TICK
+#define configTICK_RATE_HZ          ((TickType_t)62)          /* WDT tick (make wdt): 15 ms nominal, portTICK_PERIOD_MS = 16 */
+#else
 #define configTICK_RATE_HZ          ((TickType_t)100)         
+#endif
 #define configUSE_PREEMPTION        1                         /* Enable pre-emptive scheduling */
+#ifdef SIM_BUILD
+#define configUSE_16_BIT_TICKS      0                         /* POSIX port: native tick width */
+#else
 #define configUSE_16_BIT_TICKS      1                         
+#endif
 #define configMAX_PRIORITIES        5
 #define configMINIMAL_STACK_SIZE    70                        /* Idle task stack size (in words, not bytes!) */
 #define configMAX_TASK_NAME_LEN     8
@@ -33,26 +52,54 @@
 /* Idle task yields CPU to other tasks of same priority */
 #define configIDLE_SHOULD_YIELD     1
 
+/* Tickless idle: the ATMega328 port sleeps between timer expiries (not available on the POSIX and ThirdParty ATmega ports) */
+#if defined(SIM_BUILD) || defined(WDT_TICK)
+#define configUSE_TICKLESS_IDLE     0
+#else
+#define configUSE_TICKLESS_IDLE     1
+#endif
+
 /* Software Timers */
 
 #define configUSE_TIMERS                1
 #define configTIMER_TASK_PRIORITY       (configMAX_PRIORITIES - 1)
-#define configTIMER_TASK_STACK_DEPTH    configMINIMAL_STACK_SIZE
-#define configTIMER_QUEUE_LENGTH        3
+#define configTIMER_TASK_STACK_DEPTH    85                        /* Also runs the LED/buzzer pattern callbacks */
+#define configTIMER_QUEUE_LENGTH        4                         /* Patterns + absence timer are armed before the scheduler */
 
-/* Memory Allocation */
-#define configSUPPORT_STATIC_ALLOCATION     0
-#define configSUPPORT_DYNAMIC_ALLOCATION    1
-#define configTOTAL_HEAP_SIZE               800 /* Total heap size in bytes */
+/* Memory Allocation: every kernel object is static, there is no FreeRTOS heap.
+   The build prints the RAM map and fails below RAM_HEADROOM free bytes (Makefile). */
+#define configSUPPORT_STATIC_ALLOCATION     1
+#define configSUPPORT_DYNAMIC_ALLOCATION    0
+#define configKERNEL_PROVIDED_STATIC_MEMORY 1 /* Idle and timer task stacks/TCBs */
 
 /* Hook Functions */
+#ifdef WDT_TICK
+#define configUSE_IDLE_HOOK             1                         /* Watchdog feed + idle sleep (drivers/watchdog) */
+#define configUSE_TICK_HOOK             1                         /* Watchdog re-arm */
+#else
 #define configUSE_IDLE_HOOK             0
 #define configUSE_TICK_HOOK             0
+#endif
 #define configUSE_MALLOC_FAILED_HOOK    0
 #define configCHECK_FOR_STACK_OVERFLOW  0
 
+/* Run time statistics, published over I2C with the stack high-water marks (drivers/stats).
+   The ATMega328 port derives the counter from the Timer1 tick (port.c); the WDT build
+   leaves Timer1 free-running and the simulation uses its microsecond clock. */
+#define configGENERATE_RUN_TIME_STATS   1
+#if defined(SIM_BUILD) || defined(WDT_TICK)
+void task_stats_counter_init(void);
+uint32_t task_stats_counter(void);
+#undef portCONFIGURE_TIMER_FOR_RUN_TIME_STATS                     /* POSIX port.c includes portmacro.h first */
+#undef portGET_RUN_TIME_COUNTER_VALUE
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() task_stats_counter_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()         task_stats_counter()
+#endif
+
 /* API Function Inclusion */
 #define INCLUDE_vTaskSuspend            1
 #define INCLUDE_vTaskDelay              1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
 
 #endif /* FREERTOS_CONFIG_H */
\ No newline at end of file
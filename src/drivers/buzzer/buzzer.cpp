@@ -1,27 +1,29 @@
 #include "buzzer.h"
 
+static pattern_channel_t g_buzzer_channel;
+static void buzzer_apply(uint8_t mask);
+
 // Initialisation du buzzer
 void buzzer_init(void) {
-    BUZZER_DDR |= (1 << BUZZER_PIN);    
+    hal_gpio_make_output(BUZZER_PORT, (1 << BUZZER_PIN));    
     buzzer_off();
+    pattern_channel_init(&g_buzzer_channel, buzzer_apply);
 }
 
 // Allumer le buzzer
 void buzzer_on(void) {
-    BUZZER_PORT |= (1 << BUZZER_PIN);
+    hal_gpio_set(BUZZER_PORT, (1 << BUZZER_PIN));
 }
 
 // Éteindre le buzzer
 void buzzer_off(void) {
-    BUZZER_PORT &= ~(1 << BUZZER_PIN);
+    hal_gpio_clear(BUZZER_PORT, (1 << BUZZER_PIN));
 }
 
-// Bip simple (non-bloquant si utilisé avec d'autres fonctions)
+// Bip simple (bloquant)
 void buzzer_beep(uint16_t duration_ms) {
     buzzer_on();
-    for (uint16_t i = 0; i < duration_ms; i++) {
-        _delay_ms(1);
-    }
+    hal_delay_ms(duration_ms);
     buzzer_off();
 }
 
@@ -30,83 +32,112 @@ void buzzer_beep_blocking(uint16_t duration_ms) {
     buzzer_beep(duration_ms);
 }
 
+// ════════════════════════════════════════════════════════════════
+// Patterns (tables en flash jouées par le timer du canal buzzer)
+// Les étapes plus courtes qu'un tick (10 ms) durent un tick.
+// ════════════════════════════════════════════════════════════════
+
+#define ON 1
+
+// 2 bips courts
+PATTERN_STEPS(BUZZER_STARTUP) = {
+    {ON, 100}, {0, 100}, {ON, 100},
+    {0, PATTERN_HOLD},
+};
+
+// Pause pendant le pattern LED, puis 3 bips longs
+PATTERN_STEPS(BUZZER_ALERT) = {
+    {0, 900},
+    {ON, 200}, {0, 200}, {ON, 200}, {0, 200}, {ON, 200}, {0, 200},
+    {0, 500},
+};
+
+// 2 bips rapides
+PATTERN_STEPS(BUZZER_SUCCESS) = {
+    {ON, 50}, {0, 80}, {ON, 50},
+    {0, PATTERN_HOLD},
+};
+
+// 1 bip long
+PATTERN_STEPS(BUZZER_ERROR) = {
+    {ON, 500},
+    {0, PATTERN_HOLD},
+};
+
+// Bip-bip rapide (5 fois)
+PATTERN_STEPS(BUZZER_WARNING) = {
+    {ON, 100}, {0, 100}, {ON, 100}, {0, 100}, {ON, 100}, {0, 100},
+    {ON, 100}, {0, 100}, {ON, 100}, {0, 100},
+};
+
+// Montée puis descente (un cycle) : alternance à chaque tick, puis tous les
+// deux ticks. Les étapes plus courtes qu'un tick dureraient quand même un
+// tick et les deux moitiés seraient identiques.
+#define T1 PATTERN_TICK_MS
+#define T2 (2 * PATTERN_TICK_MS)
+PATTERN_STEPS(BUZZER_SIREN) = {
+    {ON, T1}, {0, T1}, {ON, T1}, {0, T1}, {ON, T1}, {0, T1}, {ON, T1}, {0, T1}, {ON, T1}, {0, T1},
+    {ON, T1}, {0, T1}, {ON, T1}, {0, T1}, {ON, T1}, {0, T1}, {ON, T1}, {0, T1}, {ON, T1}, {0, T1},
+    {ON, T2}, {0, T2}, {ON, T2}, {0, T2}, {ON, T2}, {0, T2}, {ON, T2}, {0, T2}, {ON, T2}, {0, T2},
+};
+#undef T1
+#undef T2
+
+// ... --- ...
+PATTERN_STEPS(BUZZER_MORSE_SOS) = {
+    {ON, 100}, {0, 100}, {ON, 100}, {0, 100}, {ON, 100}, {0, 300},
+    {ON, 300}, {0, 100}, {ON, 300}, {0, 100}, {ON, 300}, {0, 300},
+    {ON, 100}, {0, 100}, {ON, 100}, {0, 100}, {ON, 100}, {0, 100},
+};
+
+#undef ON
+
+static void buzzer_apply(uint8_t mask) {
+    if (mask) {
+        buzzer_on();
+    } else {
+        buzzer_off();
+    }
+}
+
 // Pattern de démarrage (2 bips courts)
 void buzzer_pattern_startup(void) {
-    buzzer_beep(100);
-    _delay_ms(100);
-    buzzer_beep(100);
+    pattern_play(&g_buzzer_channel, BUZZER_STARTUP, PATTERN_LENGTH(BUZZER_STARTUP), 1);
 }
 
-// Pattern d'alerte (3 bips longs)
+// Pattern d'alerte (3 bips longs, en boucle jusqu'à buzzer_pattern_stop())
 void buzzer_pattern_alert(void) {
-    for (uint8_t i = 0; i < 3; i++) {
-        buzzer_beep(200);
-        _delay_ms(200);
-    }
+    pattern_play(&g_buzzer_channel, BUZZER_ALERT, PATTERN_LENGTH(BUZZER_ALERT), PATTERN_LOOP);
 }
 
 // Pattern de succès (2 bips rapides)
 void buzzer_pattern_success(void) {
-    buzzer_beep(50);
-    _delay_ms(80);
-    buzzer_beep(50);
+    pattern_play(&g_buzzer_channel, BUZZER_SUCCESS, PATTERN_LENGTH(BUZZER_SUCCESS), 1);
 }
 
 // Pattern d'erreur (1 bip long)
 void buzzer_pattern_error(void) {
-    buzzer_beep(500);
+    pattern_play(&g_buzzer_channel, BUZZER_ERROR, PATTERN_LENGTH(BUZZER_ERROR), 1);
 }
 
 // Pattern d'avertissement (bip-bip rapide)
 void buzzer_pattern_warning(void) {
-    for (uint8_t i = 0; i < 5; i++) {
-        buzzer_beep(100);
-        _delay_ms(100);
-    }
+    pattern_play(&g_buzzer_channel, BUZZER_WARNING, PATTERN_LENGTH(BUZZER_WARNING), 1);
 }
 
 // Pattern sirène (alternance rapide)
 void buzzer_pattern_siren(uint8_t cycles) {
-    for (uint8_t i = 0; i < cycles; i++) {
-        // Montée
-        for (uint8_t j = 0; j < 10; j++) {
-            buzzer_on();
-            _delay_ms(5);
-            buzzer_off();
-            _delay_ms(5);
-        }
-        
-        // Descente
-        for (uint8_t j = 0; j < 10; j++) {
-            buzzer_on();
-            _delay_ms(10);
-            buzzer_off();
-            _delay_ms(10);
-        }
+    if (cycles > 0) {
+        pattern_play(&g_buzzer_channel, BUZZER_SIREN, PATTERN_LENGTH(BUZZER_SIREN), cycles);
     }
 }
 
 // Pattern Morse SOS (... --- ...)
 void buzzer_pattern_morse_sos(void) {
-    // S (3 courts)
-    for (uint8_t i = 0; i < 3; i++) {
-        buzzer_beep(100);
-        _delay_ms(100);
-    }
-    
-    _delay_ms(200);
-    
-    // O (3 longs)
-    for (uint8_t i = 0; i < 3; i++) {
-        buzzer_beep(300);
-        _delay_ms(100);
-    }
-    
-    _delay_ms(200);
-    
-    // S (3 courts)
-    for (uint8_t i = 0; i < 3; i++) {
-        buzzer_beep(100);
-        _delay_ms(100);
-    }
-}
\ No newline at end of file
+    pattern_play(&g_buzzer_channel, BUZZER_MORSE_SOS, PATTERN_LENGTH(BUZZER_MORSE_SOS), 1);
+}
+
+// Arrêter le pattern en cours et couper le buzzer
+void buzzer_pattern_stop(void) {
+    pattern_stop(&g_buzzer_channel);
+}
@@ -1,8 +1,8 @@
 #ifndef BUZZER_H
 #define BUZZER_H
 
-#include <avr/io.h>
-#include <util/delay.h>
+#include "hal/hal.h"
+#include "drivers/pattern/pattern.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -11,8 +11,7 @@ extern "C"
 #endif
 
 #define BUZZER_PIN PD7
-#define BUZZER_PORT PORTD
-#define BUZZER_DDR DDRD
+#define BUZZER_PORT HAL_PORT_D
 
     // Fonctions de base
     void buzzer_init(void);
@@ -23,7 +22,7 @@ extern "C"
     void buzzer_beep(uint16_t duration_ms);
     void buzzer_beep_blocking(uint16_t duration_ms);
 
-    // Patterns sonores prédéfinis
+    // Patterns sonores prédéfinis (non bloquants, joués par un timer FreeRTOS)
     void buzzer_pattern_startup(void);
     void buzzer_pattern_alert(void);
     void buzzer_pattern_success(void);
@@ -33,6 +32,7 @@ extern "C"
     // Patterns complexes
     void buzzer_pattern_siren(uint8_t cycles);
     void buzzer_pattern_morse_sos(void);
+    void buzzer_pattern_stop(void);
 
 #ifdef __cplusplus
 }
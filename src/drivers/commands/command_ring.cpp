@@ -0,0 +1,61 @@
+#include "command_ring.h"
+
+static_assert((COMMAND_RING_LENGTH & (COMMAND_RING_LENGTH - 1)) == 0, "COMMAND_RING_LENGTH must be a power of 2");
+
+// Empêche le compilateur de déplacer les accès à la commande de part et
+// d'autre de la publication d'un index
+#define COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+static command_t g_commands[COMMAND_RING_LENGTH];
+// Compteurs libres modulo 256 : head - tail commandes en attente
+static volatile uint8_t g_head = 0; // Ecrit par l'ISR seulement
+static volatile uint8_t g_tail = 0; // Ecrit par la tâche seulement
+static uint16_t g_dropped = 0;
+
+bool command_ring_push_from_isr(uint8_t seq, uint8_t cmd, const volatile uint8_t *args, uint8_t argc)
+{
+    uint8_t head = g_head;
+
+    if ((uint8_t)(head - g_tail) == COMMAND_RING_LENGTH)
+    {
+        g_dropped++;
+        return false;
+    }
+
+    command_t *command = &g_commands[head % COMMAND_RING_LENGTH];
+    command->seq = seq;
+    command->cmd = cmd;
+    command->argc = argc;
+    for (uint8_t n = 0; n < argc; n++)
+    {
+        command->args[n] = args[n];
+    }
+    COMPILER_BARRIER();
+    g_head = head + 1;
+    return true;
+}
+
+uint8_t command_ring_count_from_isr(void)
+{
+    return g_head - g_tail;
+}
+
+uint16_t command_ring_dropped_from_isr(void)
+{
+    return g_dropped;
+}
+
+bool command_ring_pop(command_t *command)
+{
+    uint8_t tail = g_tail;
+
+    if (tail == g_head)
+    {
+        return false;
+    }
+    COMPILER_BARRIER();
+    *command = g_commands[tail % COMMAND_RING_LENGTH];
+    COMPILER_BARRIER();
+    g_tail = tail + 1;
+    return true;
+}
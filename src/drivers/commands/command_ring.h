@@ -0,0 +1,50 @@
+#ifndef COMMAND_RING_H
+#define COMMAND_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * File des commandes écrites par le maître I2C : remplie par l'ISR TWI,
+ * vidée par la tâche logique qui les exécute dans l'ordre.
+ *
+ * Un seul producteur et un seul consommateur : l'ISR n'écrit que l'index
+ * d'écriture, la tâche que l'index de lecture (un octet chacun, lu et écrit
+ * d'un bloc sur l'AVR), sans section critique. Une commande arrivée sur une
+ * file pleine est perdue et comptée ; sa séquence ne sera jamais terminée.
+ *
+ * Le numéro de séquence est choisi par la passerelle (0 pour REG_COMMAND) :
+ * la logique publie celui de la dernière commande exécutée et son résultat
+ * dans REG_COMMAND_RESULT, et n'exécute pas une seconde fois une commande
+ * renvoyée par une écriture répétée (séquence déjà exécutée).
+ */
+
+#define COMMAND_RING_LENGTH 4 // Puissance de 2
+#define COMMAND_ARGS_MAX    4
+
+    typedef struct
+    {
+        uint8_t seq;
+        uint8_t cmd;
+        uint8_t argc;
+        uint8_t args[COMMAND_ARGS_MAX];
+    } command_t;
+
+    // Depuis l'ISR TWI : false si la file est pleine (commande perdue)
+    bool command_ring_push_from_isr(uint8_t seq, uint8_t cmd, const volatile uint8_t *args, uint8_t argc);
+    uint8_t command_ring_count_from_isr(void);
+    uint16_t command_ring_dropped_from_isr(void);
+
+    // Depuis la tâche logique : false si la file est vide
+    bool command_ring_pop(command_t *command);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
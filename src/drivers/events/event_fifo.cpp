@@ -0,0 +1,74 @@
+#include "event_fifo.h"
+#include "task.h"
+
+typedef struct
+{
+    uint8_t seq;
+    uint8_t type;
+    uint8_t tag;
+    uint16_t tick;
+} event_record_t;
+
+static event_record_t g_events[EVENT_FIFO_LENGTH];
+static uint8_t g_head = 0; // Plus ancien événement
+static uint8_t g_count = 0;
+static uint8_t g_seq = 0;
+
+void event_fifo_push(event_type_t type, uint8_t tag)
+{
+    taskENTER_CRITICAL();
+    if (g_count == EVENT_FIFO_LENGTH)
+    {
+        // Pleine : l'état le plus récent prime, la passerelle verra le trou de séquence
+        g_head = (g_head + 1) % EVENT_FIFO_LENGTH;
+        g_count--;
+    }
+
+    event_record_t *record = &g_events[(g_head + g_count) % EVENT_FIFO_LENGTH];
+    if (++g_seq == 0)
+    {
+        g_seq = 1;
+    }
+    record->seq = g_seq;
+    record->type = (uint8_t)type;
+    record->tag = tag;
+    record->tick = (uint16_t)xTaskGetTickCount();
+    g_count++;
+    taskEXIT_CRITICAL();
+}
+
+uint8_t event_fifo_count_from_isr(void)
+{
+    return g_count;
+}
+
+uint8_t event_fifo_peek_from_isr(uint8_t *block, uint8_t max_records)
+{
+    uint8_t n = g_count < max_records ? g_count : max_records;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        const event_record_t *record = &g_events[(g_head + i) % EVENT_FIFO_LENGTH];
+        block[0] = record->seq;
+        block[1] = record->type;
+        block[2] = record->tag;
+        block[3] = (record->tick >> 8) & 0xFF;
+        block[4] = record->tick & 0xFF;
+        block += EVENT_RECORD_SIZE;
+    }
+    return n * EVENT_RECORD_SIZE;
+}
+
+uint8_t event_fifo_ack_from_isr(uint8_t seq)
+{
+    for (uint8_t i = 0; i < g_count; i++)
+    {
+        if (g_events[(g_head + i) % EVENT_FIFO_LENGTH].seq == seq)
+        {
+            g_head = (g_head + i + 1) % EVENT_FIFO_LENGTH;
+            g_count -= i + 1;
+            return i + 1;
+        }
+    }
+    return 0;
+}
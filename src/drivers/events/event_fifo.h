@@ -0,0 +1,55 @@
+#ifndef EVENT_FIFO_H
+#define EVENT_FIFO_H
+
+#include "FreeRTOS.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * File d'événements horodatés remplie par la tâche logique et vidée par le
+ * maître I2C : REG_EVENT_COUNT / REG_EVENTS pour lire, REG_EVENT_ACK pour
+ * retirer ce qu'il a reçu et validé (PEC). Une lecture ratée se recommence
+ * donc sans rien perdre.
+ *
+ * Enregistrement sur le bus (EVENT_RECORD_SIZE octets, big-endian) :
+ *   seq | type | tag | tick (uint16, poids faibles du tick count)
+ *
+ * Le numéro de séquence compte tous les événements depuis le démarrage (0 est
+ * sauté) : un trou côté passerelle signale des événements perdus. Si la file
+ * est pleine, l'événement le plus ancien est écrasé.
+ */
+
+#define EVENT_FIFO_LENGTH 8
+#define EVENT_RECORD_SIZE 5
+
+    typedef enum
+    {
+        EVENT_NONE = 0, // Remplissage au-delà des événements en attente
+        EVENT_TAG_REMOVED,
+        EVENT_TAG_RETURNED,
+        EVENT_ALARM_STARTED,
+        EVENT_ALARM_STOPPED, // Objet rendu pendant l'alarme
+        EVENT_ALARM_ACKED    // Alarme arrêtée par CMD_STOP_ALARM
+    } event_type_t;
+
+    // Depuis une tâche ; tag : index du tag surveillé
+    void event_fifo_push(event_type_t type, uint8_t tag);
+
+    // Depuis l'ISR TWI (interruptions masquées)
+    uint8_t event_fifo_count_from_isr(void);
+    // Copie les max_records plus anciens événements sans les retirer, retourne le nombre d'octets
+    uint8_t event_fifo_peek_from_isr(uint8_t *block, uint8_t max_records);
+    // Retire les événements jusqu'à celui de numéro seq inclus, acquitté par le
+    // maître ; rien s'il n'est plus dans la file (déjà retiré ou écrasé).
+    // Retourne le nombre d'événements retirés.
+    uint8_t event_fifo_ack_from_isr(uint8_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
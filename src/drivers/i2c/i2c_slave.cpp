@@ -1,23 +1,306 @@
 #include "i2c_slave.h"
-#include <avr/interrupt.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "drivers/stats/task_stats.h"
+#include "drivers/events/event_fifo.h"
+#include "drivers/tags/tag_table.h"
+#include "drivers/commands/command_ring.h"
+#include "smbus_pec.h"
+
+// Limite d'une lecture SMBus en bloc
+#define I2C_TX_BLOCK_SIZE 32
+// Enregistrements renvoyés par une lecture de REG_EVENTS
+#define EVENT_DRAIN_MAX (I2C_TX_BLOCK_SIZE / EVENT_RECORD_SIZE)
 
 static volatile uint8_t g_status = 0;
-static volatile uint8_t g_pending_command = CMD_NOP;
 static volatile uint8_t g_register_pointer = 0;
 static volatile uint8_t g_rx_index = 0;
 static volatile uint8_t g_tx_index = 0;
 static volatile uint8_t g_rx_buffer[I2C_SLAVE_BUFFER_SIZE];
-static volatile char g_tag_id[8] = "OSC-01";
-static volatile uint16_t g_timer_left = 0;
+static bool g_rx_overflow = false;
+static volatile TickType_t g_countdown_start = 0;
+static volatile TickType_t g_countdown_duration = 0;
+static volatile uint16_t g_event_count = 0;
+// Le maître ne relit la photographie complète que si ce compteur a changé
+static volatile uint16_t g_generation = 0;
+static uint8_t g_snapshot_seq = 0;
+// Registres multi-octets photographiés à l'adressage (TW_ST_SLA_ACK) : les
+// octets d'une même lecture sont cohérents entre eux
+static uint8_t g_tx_block[I2C_TX_BLOCK_SIZE];
+static uint8_t g_tx_length = 0;
+static uint8_t g_tx_crc = 0;
+static uint8_t g_rx_crc = 0;
+static bool g_rx_pec_ok = false;
+static volatile uint16_t g_pec_errors = 0;
+static volatile uint16_t g_bus_errors = 0;
+static volatile uint16_t g_signals_posted = 0;
+static volatile uint16_t g_signals_merged = 0;
+static TaskHandle_t g_command_task = NULL;
+static uint32_t g_command_bits = 0;
+static volatile uint8_t g_command_seq = 0;
+static volatile uint8_t g_command_result = CMD_RESULT_NONE;
+// Enregistrements annoncés par la dernière lecture de REG_EVENT_COUNT : la
+// lecture de REG_EVENTS qui suit a une longueur connue du maître (position du
+// PEC). Diminué des enregistrements acquittés par REG_EVENT_ACK.
+static uint8_t g_events_announced = 0;
+
+static_assert(SNAPSHOT_SIZE <= sizeof(g_tx_block), "REG_SNAPSHOT does not fit in the TX block");
+static_assert(TASK_STATS_BLOCK_SIZE <= sizeof(g_tx_block), "REG_TASK_STATS does not fit in the TX block");
+static_assert(TAG_MAP_SIZE <= sizeof(g_tx_block), "REG_TAG_MAP does not fit in the TX block");
+static_assert(TAG_PAGE_SIZE <= sizeof(g_tx_block), "REG_TAG_PAGE does not fit in the TX block");
+static_assert(COMMAND_RESULT_SIZE <= sizeof(g_tx_block), "REG_COMMAND_RESULT does not fit in the TX block");
+static_assert(REG_TAG_PAGE + TAG_TABLE_MAX <= 0x100, "REG_TAG_PAGE pages overflow the register space");
+static_assert(STATUS_TAG_PRESENT == TAG_PRESENT && STATUS_TIMER_RUNNING == TAG_TIMER_RUNNING
+              && STATUS_ALARM_ACTIVE == TAG_ALARM_ACTIVE, "REG_STATUS and tag flags differ");
+
+// Secondes restantes, arrondies au-dessus (0 si le compte à rebours est arrêté ou échu)
+static uint16_t timer_left_seconds(void) {
+    TickType_t elapsed = xTaskGetTickCountFromISR() - g_countdown_start;
+
+    if (elapsed >= g_countdown_duration) {
+        return 0;
+    }
+    return (uint16_t)((g_countdown_duration - elapsed + configTICK_RATE_HZ - 1) / configTICK_RATE_HZ);
+}
+
+static uint8_t snapshot_timer_left(uint8_t *block) {
+    uint16_t left = timer_left_seconds();
+
+    block[0] = (left >> 8) & 0xFF;
+    block[1] = left & 0xFF;
+    return 2;
+}
+
+// Interruptions masquées dans l'ISR : aucun champ ne change pendant la copie
+static uint8_t snapshot_state(uint8_t *block) {
+    block[SNAPSHOT_STATUS] = g_status;
+    block[SNAPSHOT_SEQ] = ++g_snapshot_seq;
+    tag_table_name_from_isr(0, &block[SNAPSHOT_TAG_ID]);
+    snapshot_timer_left(&block[SNAPSHOT_TIMER_LEFT]);
+    block[SNAPSHOT_EVENT_COUNT] = (g_event_count >> 8) & 0xFF;
+    block[SNAPSHOT_EVENT_COUNT + 1] = g_event_count & 0xFF;
+    block[SNAPSHOT_GENERATION] = (g_generation >> 8) & 0xFF;
+    block[SNAPSHOT_GENERATION + 1] = g_generation & 0xFF;
+    return SNAPSHOT_SIZE;
+}
+
+static uint8_t snapshot_generation(uint8_t *block) {
+    block[0] = (g_generation >> 8) & 0xFF;
+    block[1] = g_generation & 0xFF;
+    return 2;
+}
+
+static uint8_t snapshot_sleep_stats(uint8_t *block) {
+    TickType_t ticks = xTaskGetTickCountFromISR();
+#if configUSE_TICKLESS_IDLE == 1
+    TickType_t sleep_ticks = xPortGetSleepTickCount();
+#else
+    TickType_t sleep_ticks = 0;
+#endif
+
+    block[0] = (ticks >> 8) & 0xFF;
+    block[1] = ticks & 0xFF;
+    block[2] = (sleep_ticks >> 8) & 0xFF;
+    block[3] = sleep_ticks & 0xFF;
+    return 4;
+}
+
+// Evénements en attente, et tick courant pour dater ceux-ci côté maître
+static uint8_t snapshot_event_count(uint8_t *block) {
+    TickType_t ticks = xTaskGetTickCountFromISR();
+
+    g_events_announced = event_fifo_count_from_isr();
+    block[0] = g_events_announced;
+    block[1] = (uint8_t)configTICK_RATE_HZ;
+    block[2] = (ticks >> 8) & 0xFF;
+    block[3] = ticks & 0xFF;
+    return 4;
+}
+
+static uint8_t snapshot_events(uint8_t *block) {
+    uint8_t n = g_events_announced < EVENT_DRAIN_MAX ? g_events_announced : EVENT_DRAIN_MAX;
+    return event_fifo_peek_from_isr(block, n);
+}
+
+static uint8_t snapshot_bus_errors(uint8_t *block) {
+    block[0] = (g_pec_errors >> 8) & 0xFF;
+    block[1] = g_pec_errors & 0xFF;
+    block[2] = (g_bus_errors >> 8) & 0xFF;
+    block[3] = g_bus_errors & 0xFF;
+    return 4;
+}
+
+static uint8_t snapshot_event_signals(uint8_t *block) {
+    block[0] = (g_signals_posted >> 8) & 0xFF;
+    block[1] = g_signals_posted & 0xFF;
+    block[2] = (g_signals_merged >> 8) & 0xFF;
+    block[3] = g_signals_merged & 0xFF;
+    return 4;
+}
+
+static uint8_t snapshot_command_result(uint8_t *block) {
+    uint16_t dropped = command_ring_dropped_from_isr();
+
+    block[COMMAND_RESULT_SEQ] = g_command_seq;
+    block[COMMAND_RESULT_CODE] = g_command_result;
+    block[COMMAND_RESULT_QUEUED] = command_ring_count_from_isr();
+    block[COMMAND_RESULT_DROPPED] = (dropped >> 8) & 0xFF;
+    block[COMMAND_RESULT_DROPPED + 1] = dropped & 0xFF;
+    return COMMAND_RESULT_SIZE;
+}
+
+// Appelé avec les interruptions masquées (section critique ou ISR)
+static void bump_generation(void) {
+    g_generation++;
+    hal_gpio_open_drain_low(I2C_ATTENTION_PORT, 1 << I2C_ATTENTION_PIN);
+}
 
 void i2c_slave_init(void) {
-    TWAR = (I2C_SLAVE_ADDRESS << 1);  // 0x42 → 0x84
-    TWCR = (1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+    hal_gpio_open_drain_release(I2C_ATTENTION_PORT, 1 << I2C_ATTENTION_PIN);
+    hal_twi_slave_init(I2C_SLAVE_ADDRESS);  // TWAR = 0x42 << 1 → 0x84
+}
+
+// Photographie le registre pointé dans g_tx_block, retourne sa longueur
+static uint8_t latch_register(uint8_t reg) {
+    switch (reg) {
+        case REG_STATUS:
+            g_tx_block[0] = g_status;
+            return 1;
+
+        case REG_TAG_ID:
+            return tag_table_name_from_isr(0, g_tx_block);
+
+        case REG_TIMER_LEFT:
+            return snapshot_timer_left(g_tx_block);
+
+        case REG_SLEEP_STATS:
+            return snapshot_sleep_stats(g_tx_block);
+
+        case REG_GENERATION:
+            hal_gpio_open_drain_release(I2C_ATTENTION_PORT, 1 << I2C_ATTENTION_PIN);
+            return snapshot_generation(g_tx_block);
+
+        case REG_BUS_ERRORS:
+            return snapshot_bus_errors(g_tx_block);
+
+        case REG_EVENT_SIGNALS:
+            return snapshot_event_signals(g_tx_block);
+
+        case REG_COMMAND_RESULT:
+            return snapshot_command_result(g_tx_block);
+
+        case REG_TASK_STATS:
+            return task_stats_snapshot(g_tx_block);
+
+        case REG_SNAPSHOT:
+            hal_gpio_open_drain_release(I2C_ATTENTION_PORT, 1 << I2C_ATTENTION_PIN);
+            return snapshot_state(g_tx_block);
+
+        case REG_EVENT_COUNT:
+            return snapshot_event_count(g_tx_block);
+
+        case REG_EVENTS:
+            return snapshot_events(g_tx_block);
+
+        case REG_TAG_MAP:
+            return tag_table_snapshot_map_from_isr(g_tx_block);
+
+        default:
+            if (reg >= REG_TAG_PAGE && reg - REG_TAG_PAGE < tag_table_count()) {
+                return tag_table_snapshot_page_from_isr(reg - REG_TAG_PAGE, g_tx_block);
+            }
+            g_tx_block[0] = 0xFF;
+            return 1;
+    }
+}
+
+// Octet suivant de la lecture : le bloc, puis son PEC, puis du bourrage à 0.
+// Un maître sans PEC lit exactement la longueur du bloc et ne voit jamais le PEC.
+static void transmit_next(void) {
+    uint8_t byte;
+
+    if (g_tx_index < g_tx_length) {
+        byte = g_tx_block[g_tx_index];
+        g_tx_crc = smbus_pec_update(g_tx_crc, byte);
+    } else if (g_tx_index == g_tx_length) {
+        byte = g_tx_crc;
+    } else {
+        byte = 0x00;
+    }
+    hal_twi_write(byte);
+
+    // L'index continue d'avancer : le bourrage ne retire rien de la file d'événements
+    if (g_tx_index < 0xFF) {
+        g_tx_index++;
+    }
 }
 
-//TODO: plus commenter cette partie
-ISR(TWI_vect) {
-    uint8_t status = TWSR & TW_STATUS_MASK;
+// Fin des enregistrements complets d'une écriture REG_COMMAND_QUEUE
+static uint8_t command_records_end(void) {
+    uint8_t end = 1;
+
+    while (end + COMMAND_HEADER_SIZE <= g_rx_index) {
+        uint8_t argc = g_rx_buffer[end + 2];
+        if (argc > COMMAND_ARGS_MAX || end + COMMAND_HEADER_SIZE + argc > g_rx_index) {
+            break;
+        }
+        end += COMMAND_HEADER_SIZE + argc;
+    }
+    return end;
+}
+
+// [REG_EVENT_ACK, seq] : le maître a validé les enregistrements jusqu'à seq
+static void receive_event_ack(void) {
+    if (!g_rx_overflow && (g_rx_index == 2 || (g_rx_index == 3 && g_rx_pec_ok))) {
+        uint8_t acked = event_fifo_ack_from_isr(g_rx_buffer[1]);
+        g_events_announced = acked < g_events_announced ? g_events_announced - acked : 0;
+    } else {
+        g_pec_errors++;
+    }
+}
+
+// Fin d'une écriture du maître : [REG_COMMAND, commande], [REG_COMMAND_QUEUE,
+// enregistrements] ou [REG_EVENT_ACK, seq], suivis ou non du PEC. Les commandes
+// vont dans la file de la logique ; retourne le pxHigherPriorityTaskWoken de
+// sa notification.
+static BaseType_t receive_complete(void) {
+    BaseType_t woken = pdFALSE;
+    uint8_t queued = 0;
+
+    if (g_rx_index < 2) {
+        return woken;
+    }
+
+    if (g_register_pointer == REG_EVENT_ACK) {
+        receive_event_ack();
+    } else if (g_register_pointer == REG_COMMAND) {
+        if (!g_rx_overflow && (g_rx_index == 2 || (g_rx_index == 3 && g_rx_pec_ok))) {
+            queued += command_ring_push_from_isr(0, g_rx_buffer[1], NULL, 0);
+        } else {
+            g_pec_errors++;
+        }
+    } else if (g_register_pointer == REG_COMMAND_QUEUE) {
+        uint8_t end = command_records_end();
+        if (!g_rx_overflow && end > 1 && (end == g_rx_index || (end + 1 == g_rx_index && g_rx_pec_ok))) {
+            for (uint8_t i = 1; i < end; i += COMMAND_HEADER_SIZE + g_rx_buffer[i + 2]) {
+                queued += command_ring_push_from_isr(g_rx_buffer[i], g_rx_buffer[i + 1],
+                                                     &g_rx_buffer[i + COMMAND_HEADER_SIZE], g_rx_buffer[i + 2]);
+            }
+        } else {
+            g_pec_errors++;
+        }
+    }
+
+    if (queued > 0 && g_command_task != NULL) {
+        xTaskNotifyFromISR(g_command_task, g_command_bits, eSetBits, &woken);
+    }
+    return woken;
+}
+
+HAL_ISR(TWI_vect) {
+    uint8_t status = hal_twi_status() & TW_STATUS_MASK;
+    uint8_t data;
+    BaseType_t woken = pdFALSE;
 
     switch (status) {
         // ════════════════════════════════════════════════════════════════
@@ -25,87 +308,106 @@ ISR(TWI_vect) {
         // ════════════════════════════════════════════════════════════════
         case TW_SR_SLA_ACK:// Maître veut ÉCRIRE → on se prépare
             g_rx_index = 0;
+            g_rx_overflow = false;
+            g_rx_crc = smbus_pec_update(0, I2C_SLAVE_ADDRESS << 1);
             break;
 
         case TW_SR_DATA_ACK:// Maître envoie des données → on stocke
-	    if (g_rx_index == 0) {
-                g_register_pointer = TWDR;
-            } else if (g_register_pointer == REG_COMMAND && g_rx_index == 1) {
-                g_pending_command = TWDR;
+            data = hal_twi_read();
+            if (g_rx_index == 0) {
+                g_register_pointer = data;
             }
-
             if (g_rx_index < I2C_SLAVE_BUFFER_SIZE) {
-                g_rx_buffer[g_rx_index++] = TWDR;
+                g_rx_buffer[g_rx_index++] = data;
+            } else {
+                g_rx_overflow = true;
             }
+
+            // Si cet octet est le dernier, c'est le PEC des octets précédents
+            g_rx_pec_ok = (data == g_rx_crc);
+            g_rx_crc = smbus_pec_update(g_rx_crc, data);
             break;
 
-        case TW_SR_STOP:// Maître a fini d'écrire 
+        case TW_SR_STOP:// Maître a fini d'écrire (STOP ou START répété)
+            woken = receive_complete();
             break;
 
         // ════════════════════════════════════════════════════════════════
         // MODE SLAVE TRANSMITTER
         // ════════════════════════════════════════════════════════════════
-        case TW_ST_SLA_ACK: // Maître veut LIRE → on envoie le 1er octet
-            
+        case TW_ST_SLA_ACK: // Maître veut LIRE → on photographie le registre et on envoie le 1er octet
             g_tx_index = 0;
-
-            switch (g_register_pointer) {
-                case REG_STATUS:
-                    TWDR = g_status;
-                    break;
-
-                case REG_TAG_ID:
-                    TWDR = g_tag_id[0];
-                    g_tx_index = 1;
-                    break;
-
-                case REG_TIMER_LEFT:
-                    TWDR = (g_timer_left >> 8) & 0xFF;
-                    g_tx_index = 1;
-                    break;
-
-                default:
-                    TWDR = 0xFF;
-                    break;
-            }
+            g_tx_length = latch_register(g_register_pointer);
+            // PEC d'une lecture SMBus : adresse en écriture, registre, adresse en lecture, données
+            g_tx_crc = smbus_pec_update(0, I2C_SLAVE_ADDRESS << 1);
+            g_tx_crc = smbus_pec_update(g_tx_crc, g_register_pointer);
+            g_tx_crc = smbus_pec_update(g_tx_crc, (I2C_SLAVE_ADDRESS << 1) | 1);
+            transmit_next();
             break;
 
-        case TW_ST_DATA_ACK:  // Maître a reçu le 1er octet → on envoie le suivant
-            switch (g_register_pointer) {
-                case REG_TAG_ID:
-                    if (g_tx_index < 8) {
-                        TWDR = g_tag_id[g_tx_index++];
-                    } else {
-                        TWDR = 0x00;
-                    }
-                    break;
-
-                case REG_TIMER_LEFT:
-                    TWDR = g_timer_left & 0xFF;
-                    g_tx_index++;
-                    break;
-
-                default:
-                    TWDR = 0xFF;
-                    break;
-            }
+        case TW_ST_DATA_ACK:  // Maître a reçu l'octet précédent → on envoie le suivant
+            transmit_next();
             break;
 
         case TW_ST_DATA_NACK: // Le maitre a fini de lire  
             break;
+
+        case TW_BUS_ERROR: // START ou STOP au milieu d'un octet (parasite sur le bus)
+            g_bus_errors++;
+            hal_twi_recover();
+            return;
     }
-    TWCR = (1 << TWINT)
-         | (1 << TWEA)
-         | (1 << TWEN)
-         | (1 << TWIE); 
+    hal_twi_ack();
+    // La logique réveillée par une commande passe avant la tâche interrompue
+    HAL_YIELD_FROM_ISR(woken);
 }
 
 void i2c_slave_set_status(uint8_t status) {
-    g_status = status;
+    taskENTER_CRITICAL();
+    if (g_status != status) {
+        g_status = status;
+        bump_generation();
+    }
+    taskEXIT_CRITICAL();
+}
+
+void i2c_slave_set_countdown(TickType_t duration) {
+    taskENTER_CRITICAL();
+    g_countdown_start = xTaskGetTickCount();
+    g_countdown_duration = duration;
+    bump_generation();
+    taskEXIT_CRITICAL();
 }
 
-uint8_t i2c_slave_get_pending_command(void) {
-    uint8_t cmd = g_pending_command;
-    g_pending_command = CMD_NOP;
-    return cmd;
+void i2c_slave_count_event(void) {
+    taskENTER_CRITICAL();
+    g_event_count++;
+    bump_generation();
+    taskEXIT_CRITICAL();
+}
+
+void i2c_slave_count_signal(bool merged) {
+    taskENTER_CRITICAL();
+    g_signals_posted++;
+    if (merged) {
+        g_signals_merged++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void i2c_slave_notify_on_command(TaskHandle_t task, uint32_t bits) {
+    taskENTER_CRITICAL();
+    g_command_task = task;
+    g_command_bits = bits;
+    taskEXIT_CRITICAL();
+}
+
+void i2c_slave_command_done(uint8_t seq, uint8_t result) {
+    taskENTER_CRITICAL();
+    if (g_command_seq != seq || g_command_result != result) {
+        g_command_seq = seq;
+        g_command_result = result;
+        bump_generation();
+    }
+    taskEXIT_CRITICAL();
 }
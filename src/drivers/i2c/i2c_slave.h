@@ -1,7 +1,9 @@
 #ifndef I2C_SLAVE_H
 #define I2C_SLAVE_H
 
-#include <avr/io.h>
+#include "hal/hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -13,6 +15,9 @@ extern "C" {
 #define I2C_SLAVE_BUFFER_SIZE 16
 #define TW_STATUS_MASK 0xF8
 
+// Condition START/STOP illégale
+#define TW_BUS_ERROR      0x00
+
 // Status codes Slave Receiver
 #define TW_SR_SLA_ACK     0x60
 #define TW_SR_DATA_ACK    0x80
@@ -23,24 +28,85 @@ extern "C" {
 #define TW_ST_DATA_ACK    0xB8
 #define TW_ST_DATA_NACK   0xC0
 
-// Registres
-#define REG_STATUS        0x00
-#define REG_TAG_ID        0x01
+// Ligne d'attention vers la passerelle : D8, open-drain active basse (pull-up
+// côté Pi). Tirée à 0 à chaque changement de REG_GENERATION, relâchée quand le
+// maître lit REG_GENERATION ou REG_SNAPSHOT. Câblée en OU entre les nœuds.
+#define I2C_ATTENTION_PORT HAL_PORT_B
+#define I2C_ATTENTION_PIN  PB0
+
+// Registres. Une lecture peut se poursuivre d'un octet après le registre :
+// c'est le PEC SMBus (CRC-8) de la transaction, cf. smbus_pec.h.
+#define REG_STATUS        0x00  // Etat agrégé de la table de tags (STATUS_*)
+#define REG_TAG_ID        0x01  // Nom du tag 0 de la table
 #define REG_TIMER_LEFT    0x09
-#define REG_COMMAND       0x10
+#define REG_SLEEP_STATS   0x0B  // Tick count + ticks asleep (2 x uint16 BE)
+#define REG_GENERATION    0x0F  // Bumped on every change of the published state (uint16 BE)
+#define REG_COMMAND       0x10  // Write [0x10, cmd] or [0x10, cmd, PEC]
+#define REG_BUS_ERRORS    0x11  // Writes rejected for a bad PEC, TWI bus errors (2 x uint16 BE)
+#define REG_EVENT_SIGNALS 0x12  // Events posted to the logic task, merged with a pending one (2 x uint16 BE)
+#define REG_COMMAND_RESULT 0x13 // Last command executed: seq, result, queued, dropped (uint16 BE)
+#define REG_COMMAND_QUEUE 0x14  // Write several commands with their seq and arguments (see below)
+#define REG_TASK_STATS    0x20  // Per-task stack high-water mark + run time (drivers/stats)
+#define REG_SNAPSHOT      0x30  // Status, seq, tag ID, timer left, event count (one block read)
+#define REG_EVENT_COUNT   0x40  // Pending events, tick rate (Hz), tick count (uint16 BE)
+#define REG_EVENTS        0x41  // Oldest pending records (drivers/events/event_fifo.h)
+#define REG_EVENT_ACK     0x42  // Write [0x42, seq] or [0x42, seq, PEC]: records up to seq leave the FIFO
+#define REG_TAG_MAP       0x50  // Tag count + presence/timer/alarm bitmaps (drivers/tags/tag_table.h)
+#define REG_TAG_PAGE      0x60  // 0x60 + i: state, name, ages and ID of tag i
+
+// Bloc REG_SNAPSHOT (big-endian), photographié à l'adressage en lecture
+#define SNAPSHOT_STATUS       0   // REG_STATUS
+#define SNAPSHOT_SEQ          1   // Numéro de la photographie, +1 à chaque lecture du bloc
+#define SNAPSHOT_TAG_ID       2   // REG_TAG_ID, 8 octets
+#define SNAPSHOT_TIMER_LEFT   10  // REG_TIMER_LEFT, secondes avant la première alarme (uint16)
+#define SNAPSHOT_EVENT_COUNT  12  // Réveils de la logique qui ont ajouté des événements (uint16)
+#define SNAPSHOT_GENERATION   14  // REG_GENERATION correspondant à cette photographie (uint16)
+#define SNAPSHOT_SIZE         16
+
+// Bloc REG_COMMAND_RESULT (big-endian)
+#define COMMAND_RESULT_SEQ      0   // Séquence de la dernière commande exécutée (0 pour REG_COMMAND)
+#define COMMAND_RESULT_CODE     1   // Son résultat (CMD_RESULT_*)
+#define COMMAND_RESULT_QUEUED   2   // Commandes reçues, pas encore exécutées
+#define COMMAND_RESULT_DROPPED  3   // Commandes perdues, file pleine (uint16)
+#define COMMAND_RESULT_SIZE     5
+
+// Ecriture REG_COMMAND_QUEUE : enregistrements [seq, commande, argc, argc
+// arguments] à la suite, puis le PEC éventuel. Rejetée en entier (comptée
+// dans REG_BUS_ERRORS) si un enregistrement est incomplet ou le PEC faux.
+#define COMMAND_HEADER_SIZE 3
 
 // Commandes
 #define CMD_NOP           0x00
-#define CMD_STOP_ALARM     0x01
+#define CMD_STOP_ALARM     0x01  // Sans argument : tous les tags ; [i] : le tag i
+
+// Résultats
+#define CMD_RESULT_OK        0x00
+#define CMD_RESULT_UNKNOWN   0x01  // Commande inconnue
+#define CMD_RESULT_BAD_ARGS  0x02  // Arguments invalides pour la commande
+#define CMD_RESULT_NONE      0xFF  // Aucune commande exécutée depuis le démarrage
 
-// Status flags
+// Status flags : tous les tags présents, un compte à rebours / une alarme au moins
 #define STATUS_TAG_PRESENT   (1 << 0)
 #define STATUS_TIMER_RUNNING (1 << 1)
 #define STATUS_ALARM_ACTIVE  (1 << 2)
 
 void i2c_slave_init(void);
+// Chaque setter incrémente REG_GENERATION quand l'état publié change
 void i2c_slave_set_status(uint8_t status);
-uint8_t i2c_slave_get_pending_command(void);
+// Compte à rebours publié dans REG_TIMER_LEFT (0 : arrêté), le plus proche de la table
+void i2c_slave_set_countdown(TickType_t duration);
+// Enregistrements ajoutés à drivers/events par un réveil de la logique, après
+// les event_fifo_push : compté dans REG_SNAPSHOT
+void i2c_slave_count_event(void);
+// Evénement signalé à la logique (depuis une tâche), merged : le même était
+// encore en attente et n'a pas été délivré une seconde fois
+void i2c_slave_count_signal(bool merged);
+// Tâche réveillée par l'ISR TWI à la fin d'une écriture de commandes : bits
+// levés dans sa valeur de notification (eSetBits), puis command_ring_pop()
+// depuis la tâche (drivers/commands)
+void i2c_slave_notify_on_command(TaskHandle_t task, uint32_t bits);
+// Commande exécutée par la logique : publiée dans REG_COMMAND_RESULT
+void i2c_slave_command_done(uint8_t seq, uint8_t result);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,24 @@
+#ifndef SMBUS_PEC_H
+#define SMBUS_PEC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Packet Error Code SMBus : CRC-8, polynôme x^8 + x^2 + x + 1 (0x07), valeur
+ * initiale 0, calculé sur tous les octets de la transaction, octets d'adresse
+ * compris. Une table de 256 octets en flash donne le résultat en un accès par
+ * octet, assez court pour l'ISR TWI.
+ */
+
+    uint8_t smbus_pec_update(uint8_t crc, uint8_t byte);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
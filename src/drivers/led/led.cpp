@@ -1,11 +1,15 @@
 #include "led.h"
 
+static pattern_channel_t g_led_channel;
+static void led_apply(uint8_t mask);
+
 void led_init_all(void)
 {
-    LED_DDR |= (1 << LED_RED_PIN) | (1 << LED_GREEN_PIN) | (1 << LED_BLUE_PIN);
-    LED_BUILTIN_DDR |= (1 << LED_BUILTIN_PIN);
+    hal_gpio_make_output(LED_PORT, (1 << LED_RED_PIN) | (1 << LED_GREEN_PIN) | (1 << LED_BLUE_PIN));
+    hal_gpio_make_output(LED_BUILTIN_PORT, (1 << LED_BUILTIN_PIN));
 
     led_all_off();
+    pattern_channel_init(&g_led_channel, led_apply);
 }
 
 // Allumer une LED spécifique
@@ -14,16 +18,16 @@ void led_on(led_id_t led)
     switch (led)
     {
     case LED_RED:
-        LED_PORT |= (1 << LED_RED_PIN);
+        hal_gpio_set(LED_PORT, (1 << LED_RED_PIN));
         break;
     case LED_GREEN:
-        LED_PORT |= (1 << LED_GREEN_PIN);
+        hal_gpio_set(LED_PORT, (1 << LED_GREEN_PIN));
         break;
     case LED_BLUE:
-        LED_PORT |= (1 << LED_BLUE_PIN);
+        hal_gpio_set(LED_PORT, (1 << LED_BLUE_PIN));
         break;
     case LED_BUILTIN_IN:
-        LED_BUILTIN_PORT |= (1 << LED_BUILTIN_PIN);
+        hal_gpio_set(LED_BUILTIN_PORT, (1 << LED_BUILTIN_PIN));
         break;
     }
 }
@@ -34,16 +38,16 @@ void led_off(led_id_t led)
     switch (led)
     {
     case LED_RED:
-        LED_PORT &= ~(1 << LED_RED_PIN);
+        hal_gpio_clear(LED_PORT, (1 << LED_RED_PIN));
         break;
     case LED_GREEN:
-        LED_PORT &= ~(1 << LED_GREEN_PIN);
+        hal_gpio_clear(LED_PORT, (1 << LED_GREEN_PIN));
         break;
     case LED_BLUE:
-        LED_PORT &= ~(1 << LED_BLUE_PIN);
+        hal_gpio_clear(LED_PORT, (1 << LED_BLUE_PIN));
         break;
     case LED_BUILTIN_IN:
-        LED_BUILTIN_PORT &= ~(1 << LED_BUILTIN_PIN);
+        hal_gpio_clear(LED_BUILTIN_PORT, (1 << LED_BUILTIN_PIN));
         break;
     }
 }
@@ -54,16 +58,16 @@ void led_toggle(led_id_t led)
     switch (led)
     {
     case LED_RED:
-        LED_PORT ^= (1 << LED_RED_PIN);
+        hal_gpio_toggle(LED_PORT, (1 << LED_RED_PIN));
         break;
     case LED_GREEN:
-        LED_PORT ^= (1 << LED_GREEN_PIN);
+        hal_gpio_toggle(LED_PORT, (1 << LED_GREEN_PIN));
         break;
     case LED_BLUE:
-        LED_PORT ^= (1 << LED_BLUE_PIN);
+        hal_gpio_toggle(LED_PORT, (1 << LED_BLUE_PIN));
         break;
     case LED_BUILTIN_IN:
-        LED_BUILTIN_PORT ^= (1 << LED_BUILTIN_PIN);
+        hal_gpio_toggle(LED_BUILTIN_PORT, (1 << LED_BUILTIN_PIN));
         break;
     }
 }
@@ -72,10 +76,7 @@ void led_toggle(led_id_t led)
 void led_blink(led_id_t led, uint16_t duration_ms)
 {
     led_on(led);
-    for (uint16_t i = 0; i < duration_ms; i++)
-    {
-        _delay_ms(1);
-    }
+    hal_delay_ms(duration_ms);
     led_off(led);
 }
 
@@ -97,98 +98,109 @@ void led_all_off(void)
     led_off(LED_BUILTIN_IN);
 }
 
-// Pattern de démarrage
-void led_pattern_startup(void)
+// ════════════════════════════════════════════════════════════════
+// Patterns (tables en flash jouées par le timer du canal LED)
+// ════════════════════════════════════════════════════════════════
+
+#define R LED_MASK(LED_RED)
+#define G LED_MASK(LED_GREEN)
+#define B LED_MASK(LED_BLUE)
+#define IN LED_MASK(LED_BUILTIN_IN)
+
+// Séquence rouge -> vert -> bleu, puis toutes ensemble
+PATTERN_STEPS(LED_STARTUP) = {
+    {R, 200}, {0, 50}, {G, 200}, {0, 50}, {B, 200}, {0, 50},
+    {R | G | B | IN, 300},
+};
+
+// Rouge clignotant (3 fois), puis pause pendant le pattern du buzzer
+PATTERN_STEPS(LED_ALERT) = {
+    {R | IN, 150}, {0, 150}, {R | IN, 150}, {0, 150}, {R | IN, 150}, {0, 150},
+    {0, 1700},
+};
+
+// Vert clignotant rapide, puis vert fixe
+PATTERN_STEPS(LED_SUCCESS) = {
+    {G, 80}, {0, 80}, {G, 80}, {0, 80},
+    {G, PATTERN_HOLD},
+};
+
+// Etats fixes de la logique, joués comme des patterns pour que le timer du
+// canal ne les écrase pas avec la fin d'un pattern en cours
+PATTERN_STEPS(LED_READY) = {
+    {G, PATTERN_HOLD},
+};
+
+PATTERN_STEPS(LED_COUNTDOWN) = {
+    {B, PATTERN_HOLD},
+};
+
+// Séquence de test
+PATTERN_STEPS(LED_SEQUENCE) = {
+    {R | IN, 500}, {G | IN, 500}, {B | IN, 500}, {R | G | B | IN, 500}, {0, 500},
+    {R, 100}, {G, 100}, {B, 100}, {R, 100}, {G, 100}, {B, 100},
+    {R, 100}, {G, 100}, {B, 100}, {R, 100}, {G, 100}, {B, 100},
+    {R, 100}, {G, 100}, {B, 100},
+};
+
+#undef R
+#undef G
+#undef B
+#undef IN
+
+static void led_apply(uint8_t mask)
 {
-    led_all_off();
+    for (uint8_t led = LED_RED; led <= LED_BUILTIN_IN; led++)
+    {
+        if (mask & LED_MASK(led))
+        {
+            led_on((led_id_t)led);
+        }
+        else
+        {
+            led_off((led_id_t)led);
+        }
+    }
+}
 
-    // Séquence rouge -> vert -> bleu
-    led_blink(LED_RED, 200);
-    _delay_ms(50);
-    led_blink(LED_GREEN, 200);
-    _delay_ms(50);
-    led_blink(LED_BLUE, 200);
-    _delay_ms(50);
-
-    // Toutes ensemble
-    led_all_on();
-    _delay_ms(300);
-    led_all_off();
+// Pattern de démarrage (joué une fois)
+void led_pattern_startup(void)
+{
+    pattern_play(&g_led_channel, LED_STARTUP, PATTERN_LENGTH(LED_STARTUP), 1);
 }
 
-// Pattern d'alerte (rouge clignotant)
+// Pattern d'alerte (rouge clignotant, en boucle jusqu'à led_pattern_stop())
 void led_pattern_alert(void)
 {
-    led_all_off();
-
-    for (uint8_t i = 0; i < 3; i++)
-    {
-        led_on(LED_RED);
-        led_on(LED_BUILTIN_IN);
-        _delay_ms(150);
-        led_off(LED_RED);
-        led_off(LED_BUILTIN_IN);
-        _delay_ms(150);
-    }
+    pattern_play(&g_led_channel, LED_ALERT, PATTERN_LENGTH(LED_ALERT), PATTERN_LOOP);
 }
 
-// Pattern de succès (vert clignotant rapide)
+// Pattern de succès (vert clignotant rapide, se termine vert fixe)
 void led_pattern_success(void)
 {
-    led_all_off();
+    pattern_play(&g_led_channel, LED_SUCCESS, PATTERN_LENGTH(LED_SUCCESS), 1);
+}
 
-    for (uint8_t i = 0; i < 2; i++)
-    {
-        led_on(LED_GREEN);
-        _delay_ms(80);
-        led_off(LED_GREEN);
-        _delay_ms(80);
-    }
+// Vert fixe : tous les tags sont en place
+void led_pattern_ready(void)
+{
+    pattern_play(&g_led_channel, LED_READY, PATTERN_LENGTH(LED_READY), 1);
+}
+
+// Bleu fixe : compte à rebours en cours
+void led_pattern_countdown(void)
+{
+    pattern_play(&g_led_channel, LED_COUNTDOWN, PATTERN_LENGTH(LED_COUNTDOWN), 1);
 }
 
 // Pattern séquence (pour test)
 void led_pattern_sequence(void)
 {
-    led_all_off();
-
-    // Rouge
-    led_on(LED_RED);
-    led_on(LED_BUILTIN_IN);
-    _delay_ms(500);
-
-    // Vert
-    led_all_off();
-    led_on(LED_GREEN);
-    led_on(LED_BUILTIN_IN);
-    _delay_ms(500);
-
-    // Bleu
-    led_all_off();
-    led_on(LED_BLUE);
-    led_on(LED_BUILTIN_IN);
-    _delay_ms(500);
-
-    // Toutes
-    led_all_on();
-    _delay_ms(500);
-
-    // Éteintes
-    led_all_off();
-    _delay_ms(500);
-
-    // Clignotement rapide
-    for (uint8_t i = 0; i < 5; i++)
-    {
-        led_on(LED_RED);
-        _delay_ms(100);
-        led_off(LED_RED);
-
-        led_on(LED_GREEN);
-        _delay_ms(100);
-        led_off(LED_GREEN);
+    pattern_play(&g_led_channel, LED_SEQUENCE, PATTERN_LENGTH(LED_SEQUENCE), 1);
+}
 
-        led_on(LED_BLUE);
-        _delay_ms(100);
-        led_off(LED_BLUE);
-    }
-}
\ No newline at end of file
+// Arrêter le pattern en cours et éteindre toutes les LEDs
+void led_pattern_stop(void)
+{
+    pattern_stop(&g_led_channel);
+}
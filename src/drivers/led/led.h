@@ -1,8 +1,8 @@
 #ifndef LED_H
 #define LED_H
 
-#include <avr/io.h>
-#include <util/delay.h>
+#include "hal/hal.h"
+#include "drivers/pattern/pattern.h"
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -15,13 +15,11 @@ extern "C"
 #define LED_GREEN_PIN PD5
 #define LED_BLUE_PIN PD6
 
-#define LED_PORT PORTD
-#define LED_DDR DDRD
+#define LED_PORT HAL_PORT_D
 
 // LED intégrée (Pin 13) pour debug
 #define LED_BUILTIN_PIN PB5
-#define LED_BUILTIN_DDR DDRB
-#define LED_BUILTIN_PORT PORTB
+#define LED_BUILTIN_PORT HAL_PORT_B
 
     // Type énuméré pour identifier les LEDs
     typedef enum
@@ -32,6 +30,9 @@ extern "C"
         LED_BUILTIN_IN
     } led_id_t;
 
+// Masque d'une LED dans les étapes de pattern
+#define LED_MASK(led) (1 << (led))
+
     // Fonctions d'initialisation
     void led_init_all(void);
 
@@ -45,11 +46,16 @@ extern "C"
     void led_all_on(void);
     void led_all_off(void);
 
-    // Patterns prédéfinis
+    // Patterns prédéfinis (non bloquants, joués par un timer FreeRTOS). Un
+    // pattern remplace le précédent : pendant qu'ils sont utilisés, les LEDs
+    // ne se pilotent pas avec led_on() / led_off().
     void led_pattern_startup(void);
     void led_pattern_alert(void);
     void led_pattern_success(void);
+    void led_pattern_ready(void);
+    void led_pattern_countdown(void);
     void led_pattern_sequence(void);
+    void led_pattern_stop(void);
 
 #ifdef __cplusplus
 }
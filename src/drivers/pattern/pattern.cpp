@@ -0,0 +1,111 @@
+#include "pattern.h"
+
+static uint8_t step_mask(const pattern_channel_t *channel)
+{
+    return hal_flash_read_byte(&channel->steps[channel->index].mask);
+}
+
+static uint16_t step_duration(const pattern_channel_t *channel)
+{
+    return hal_flash_read_word(&channel->steps[channel->index].duration_ms);
+}
+
+static TickType_t step_ticks(uint16_t duration_ms)
+{
+    TickType_t ticks = pdMS_TO_TICKS(duration_ms);
+    return ticks > 0 ? ticks : 1;
+}
+
+// Fin d'une étape : exécuté par la tâche des timers FreeRTOS
+static void pattern_timer_callback(TimerHandle_t xTimer)
+{
+    pattern_channel_t *channel = (pattern_channel_t *)pvTimerGetTimerID(xTimer);
+    uint16_t duration;
+
+    taskENTER_CRITICAL();
+    if (channel->steps == NULL)
+    {
+        taskEXIT_CRITICAL();
+        return;
+    }
+
+    channel->index++;
+    if (channel->index >= channel->length)
+    {
+        channel->index = 0;
+        if (channel->repeat_left != PATTERN_LOOP && --channel->repeat_left == 0)
+        {
+            // Fin du pattern : tout éteindre
+            channel->steps = NULL;
+            channel->apply(0);
+            taskEXIT_CRITICAL();
+            return;
+        }
+    }
+
+    channel->apply(step_mask(channel));
+    duration = step_duration(channel);
+    if (duration == PATTERN_HOLD)
+    {
+        channel->steps = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    if (duration != PATTERN_HOLD)
+    {
+        xTimerChangePeriod(xTimer, step_ticks(duration), 0);
+    }
+}
+
+void pattern_channel_init(pattern_channel_t *channel, pattern_apply_t apply)
+{
+    channel->apply = apply;
+    channel->steps = NULL;
+    channel->length = 0;
+    channel->index = 0;
+    channel->repeat_left = 0;
+    channel->timer = xTimerCreateStatic(NULL, 1, pdFALSE, channel, pattern_timer_callback, &channel->timer_buffer);
+}
+
+void pattern_play(pattern_channel_t *channel, const pattern_step_t *steps, uint8_t length, uint8_t repeat)
+{
+    uint16_t duration;
+
+    taskENTER_CRITICAL();
+    channel->steps = steps;
+    channel->length = length;
+    channel->index = 0;
+    channel->repeat_left = repeat;
+    channel->apply(step_mask(channel));
+    duration = step_duration(channel);
+    if (duration == PATTERN_HOLD)
+    {
+        channel->steps = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    // La première étape est déjà appliquée : on arme le timer pour la suivante
+    if (duration == PATTERN_HOLD)
+    {
+        xTimerStop(channel->timer, 0);
+    }
+    else
+    {
+        xTimerChangePeriod(channel->timer, step_ticks(duration), 0);
+    }
+}
+
+void pattern_stop(pattern_channel_t *channel)
+{
+    taskENTER_CRITICAL();
+    channel->steps = NULL;
+    channel->apply(0);
+    taskEXIT_CRITICAL();
+
+    xTimerStop(channel->timer, 0);
+}
+
+bool pattern_is_playing(const pattern_channel_t *channel)
+{
+    return channel->steps != NULL;
+}
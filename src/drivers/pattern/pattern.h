@@ -0,0 +1,66 @@
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include "hal/hal.h"
+#include "FreeRTOS.h"
+#include "timers.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Nombre de répétitions : jouer en boucle jusqu'à pattern_stop()
+#define PATTERN_LOOP 0
+
+// Une étape dure au minimum un tick (10 ms). Une durée nulle termine le
+// pattern en laissant les sorties dans l'état de cette étape.
+#define PATTERN_HOLD 0
+
+// Durée d'un tick arrondie au-dessus (10 ms, 17 ms avec le tick WDT) : une
+// étape de n * PATTERN_TICK_MS dure n ticks, quel que soit configTICK_RATE_HZ
+#define PATTERN_TICK_MS ((1000 + configTICK_RATE_HZ - 1) / configTICK_RATE_HZ)
+
+    // Etape d'un pattern : sorties actives (masque propre au canal) et durée
+    typedef struct
+    {
+        uint8_t mask;
+        uint16_t duration_ms;
+    } pattern_step_t;
+
+    // Applique un masque de sorties (LEDs, buzzer...)
+    typedef void (*pattern_apply_t)(uint8_t mask);
+
+    // Canal de lecture : un timer logiciel FreeRTOS par canal
+    typedef struct
+    {
+        TimerHandle_t timer;
+        StaticTimer_t timer_buffer;
+        pattern_apply_t apply;
+        const pattern_step_t *steps; // Table en flash, NULL si aucun pattern
+        uint8_t length;
+        uint8_t index;
+        uint8_t repeat_left;         // PATTERN_LOOP = infini
+    } pattern_channel_t;
+
+    void pattern_channel_init(pattern_channel_t *channel, pattern_apply_t apply);
+
+    // Démarre (ou remplace) un pattern ; retourne immédiatement
+    void pattern_play(pattern_channel_t *channel, const pattern_step_t *steps, uint8_t length, uint8_t repeat);
+
+    // Arrête le pattern en cours et éteint toutes les sorties du canal
+    void pattern_stop(pattern_channel_t *channel);
+
+    bool pattern_is_playing(const pattern_channel_t *channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+// Table d'étapes stockée en flash
+#define PATTERN_STEPS(name) static const pattern_step_t name[] HAL_PROGMEM
+#define PATTERN_LENGTH(steps) ((uint8_t)(sizeof(steps) / sizeof((steps)[0])))
+
+#endif
@@ -1,42 +1,108 @@
 #include "rfid.h"
+#include "task.h"
 
-RFID::RFID(uint8_t rxPin, uint8_t txPin)
-    : softSerial(rxPin, txPin), count(0)
+#ifdef RFID_USE_USART
+
+// Instance servie par l'interruption de réception
+static RFID *g_usart_rfid = NULL;
+
+RFID::RFID(uint8_t, uint8_t)
+    : tagQueue(NULL)
 {
+    rfid_frame_reset(&decoder);
 }
 
 void RFID::init()
 {
-    // Initialize SoftwareSerial for RFID communication
-    softSerial.begin(9600);
+    tagQueue = xQueueCreateStatic(RFID_TAG_QUEUE_LENGTH, sizeof(rfid_tag_t), tagQueueStorage, &tagQueueBuffer);
+    g_usart_rfid = this;
+    hal_uart_init(RFID_BAUD_RATE);
 }
 
-bool RFID::available()
+HAL_ISR(USART_RX_vect)
 {
-    // Check if tag data is available
-    return softSerial.available() > 0;
+    BaseType_t woken = g_usart_rfid->receive_from_isr(hal_uart_read());
+    // La tâche ReadTag réveillée par une trame passe avant la tâche interrompue
+    HAL_YIELD_FROM_ISR(woken);
 }
 
-// Read data from RFID tag into buffer
-int RFID::read()
+// Decode in the RX interrupt: the task only wakes up for complete, valid frames
+BaseType_t RFID::receive_from_isr(uint8_t byte)
 {
-    while (softSerial.available())
+    rfid_tag_t tag;
+    BaseType_t woken = pdFALSE;
+
+    if (rfid_frame_feed(&decoder, byte, &tag))
     {
-        buffer[count++] = softSerial.read();
-        if (count >= RFID_BUFFER_SIZE)
-            break;
+        xQueueSendFromISR(tagQueue, &tag, &woken);
     }
-    return count;
+    return woken;
 }
 
-unsigned char *RFID::get_buffer()
+// Bytes are already decoded by the RX interrupt
+void RFID::poll()
 {
-    return buffer;
 }
 
-void RFID::clear()
+bool RFID::wait_tag(rfid_tag_t *tag, TickType_t timeout)
 {
-    for (int i = 0; i < count; i++)
-        buffer[i] = 0;
-    count = 0;
+    return xQueueReceive(tagQueue, tag, timeout) == pdPASS;
+}
+
+#else
+
+RFID::RFID(uint8_t rxPin, uint8_t txPin)
+    : softSerial(rxPin, txPin), tagQueue(NULL)
+{
+    rfid_frame_reset(&decoder);
+}
+
+void RFID::init()
+{
+    // Initialize SoftwareSerial for RFID communication
+    softSerial.begin(RFID_BAUD_RATE);
+    tagQueue = xQueueCreateStatic(RFID_TAG_QUEUE_LENGTH, sizeof(rfid_tag_t), tagQueueStorage, &tagQueueBuffer);
 }
+
+// Feed every received byte to the frame decoder
+void RFID::poll()
+{
+    rfid_tag_t tag;
+
+    while (softSerial.available() > 0)
+    {
+        if (rfid_frame_feed(&decoder, (uint8_t)softSerial.read(), &tag))
+        {
+            // Queue full: the same tag is already waiting to be read
+            xQueueSend(tagQueue, &tag, 0);
+        }
+    }
+}
+
+bool RFID::wait_tag(rfid_tag_t *tag, TickType_t timeout)
+{
+    TimeOut_t xTimeOut;
+
+    vTaskSetTimeOutState(&xTimeOut);
+    for (;;)
+    {
+        // SoftwareSerial has no receive callback: decode what arrived so far
+        poll();
+
+        TickType_t wait = pdMS_TO_TICKS(RFID_POLL_MS);
+        if (timeout < wait)
+        {
+            wait = timeout;
+        }
+        if (xQueueReceive(tagQueue, tag, wait) == pdPASS)
+        {
+            return true;
+        }
+        if (xTaskCheckForTimeOut(&xTimeOut, &timeout) == pdTRUE)
+        {
+            return false;
+        }
+    }
+}
+
+#endif
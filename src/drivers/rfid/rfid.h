@@ -1,25 +1,60 @@
 #ifndef RFID_H
 #define RFID_H
 
+/*
+ * Lecteur RFID Grove 125 kHz (9600 bauds).
+ *
+ * Par défaut le lecteur est sur SoftwareSerial (D2/D3). Avec RFID_USE_USART
+ * (make RFID_USART=1) il est branché sur l'USART matériel (RX = D0) : les
+ * octets sont décodés dans l'interruption de réception, qui ne masque jamais
+ * le tick FreeRTOS ni l'ISR TWI.
+ */
+
+#ifndef RFID_USE_USART
 #include <SoftwareSerial.h>
+#endif
+#include "hal/hal.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "rfid_frame.h"
+
+#define RFID_BAUD_RATE 9600
 
-#define RFID_BUFFER_SIZE 16
+// Nombre de tags décodés en attente de lecture par la tâche
+#define RFID_TAG_QUEUE_LENGTH 2
+
+// SoftwareSerial n'a pas de callback de réception : période de décodage des
+// octets reçus pendant wait_tag() (doit rester < TAG_ABSENCE_TIMEOUT_MS)
+#define RFID_POLL_MS 200
 
 class RFID
 {
 public:
+    // Broches SoftwareSerial, ignorées avec RFID_USE_USART
     RFID(uint8_t rxPin, uint8_t txPin);
 
     void init();
-    bool available();
-    int read();
-    unsigned char *get_buffer();
-    void clear();
+
+    // Décode les octets reçus et poste chaque trame valide dans la file
+    void poll();
+
+    // Attend le prochain tag décodé (false si timeout, portMAX_DELAY = sans limite)
+    bool wait_tag(rfid_tag_t *tag, TickType_t timeout);
+
+#ifdef RFID_USE_USART
+    // Appelé par USART_RX_vect pour chaque octet reçu, retourne le
+    // pxHigherPriorityTaskWoken de l'envoi d'une trame complète
+    BaseType_t receive_from_isr(uint8_t byte);
+#endif
 
 private:
+#ifndef RFID_USE_USART
     SoftwareSerial softSerial;
-    unsigned char buffer[RFID_BUFFER_SIZE];
-    uint8_t count;
+#endif
+    rfid_frame_decoder_t decoder;
+    QueueHandle_t tagQueue;
+    StaticQueue_t tagQueueBuffer;
+    uint8_t tagQueueStorage[RFID_TAG_QUEUE_LENGTH * sizeof(rfid_tag_t)];
 };
 
 #endif
@@ -0,0 +1,73 @@
+#include "rfid_frame.h"
+
+#define FRAME_HEX_CHARS (2 * (RFID_TAG_ID_SIZE + 1)) // ID + checksum
+
+// Valeur d'un caractère hexa ASCII, 0xFF si invalide
+static uint8_t hex_value(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    c |= 0x20; // Minuscule
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return 0xFF;
+}
+
+void rfid_frame_reset(rfid_frame_decoder_t *decoder)
+{
+    decoder->index = 0;
+    decoder->value = 0;
+    decoder->checksum = 0;
+}
+
+bool rfid_frame_feed(rfid_frame_decoder_t *decoder, uint8_t byte, rfid_tag_t *tag)
+{
+    // Un STX resynchronise toujours le décodeur, même au milieu d'une trame
+    if (byte == RFID_FRAME_STX)
+    {
+        rfid_frame_reset(decoder);
+        decoder->index = 1;
+        return false;
+    }
+
+    if (decoder->index == 0)
+    {
+        return false;
+    }
+
+    if (decoder->index > FRAME_HEX_CHARS)
+    {
+        // Fin de trame : ETX et checksum (dernier octet assemblé) corrects
+        bool valid = (byte == RFID_FRAME_ETX) && (decoder->value == decoder->checksum);
+        if (valid)
+        {
+            *tag = decoder->tag;
+        }
+        rfid_frame_reset(decoder);
+        return valid;
+    }
+
+    uint8_t nibble = hex_value(byte);
+    if (nibble == 0xFF)
+    {
+        rfid_frame_reset(decoder);
+        return false;
+    }
+
+    decoder->value = (decoder->value << 4) | nibble;
+    if ((decoder->index & 1) == 0)
+    {
+        uint8_t n = decoder->index / 2 - 1;
+        if (n < RFID_TAG_ID_SIZE)
+        {
+            decoder->tag.bytes[n] = decoder->value;
+            decoder->checksum ^= decoder->value;
+        }
+    }
+    decoder->index++;
+    return false;
+}
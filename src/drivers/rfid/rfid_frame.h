@@ -0,0 +1,49 @@
+#ifndef RFID_FRAME_H
+#define RFID_FRAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Trame du lecteur Grove 125 kHz (mode UART, 9600 bauds) :
+ *
+ *   STX | 10 caractères hexa ASCII (ID) | 2 caractères hexa (checksum) | ETX
+ *
+ * Le checksum est le XOR des 5 octets de l'ID. Le décodeur est alimenté
+ * octet par octet et ne fait aucune allocation, il peut donc tourner dans
+ * une routine d'interruption.
+ */
+
+#define RFID_FRAME_STX 0x02
+#define RFID_FRAME_ETX 0x03
+#define RFID_TAG_ID_SIZE 5
+
+    // ID 40 bits d'un tag (octet de poids fort en premier)
+    typedef struct
+    {
+        uint8_t bytes[RFID_TAG_ID_SIZE];
+    } rfid_tag_t;
+
+    typedef struct
+    {
+        uint8_t index;    // 0 = attente STX, 1..12 = caractère hexa attendu, 13 = attente ETX
+        uint8_t value;    // Octet en cours d'assemblage
+        uint8_t checksum; // XOR des octets de l'ID déjà reçus
+        rfid_tag_t tag;
+    } rfid_frame_decoder_t;
+
+    void rfid_frame_reset(rfid_frame_decoder_t *decoder);
+
+    // Retourne true quand l'octet termine une trame valide (ID copié dans tag)
+    bool rfid_frame_feed(rfid_frame_decoder_t *decoder, uint8_t byte, rfid_tag_t *tag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
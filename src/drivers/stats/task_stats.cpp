@@ -0,0 +1,112 @@
+#include "task_stats.h"
+#include "hal/hal.h"
+#include "timers.h"
+
+static TaskHandle_t g_app_tasks[TASK_STATS_APP_TASKS];
+static uint8_t g_app_task_count = 0;
+
+void task_stats_add(TaskHandle_t task)
+{
+    if (g_app_task_count < TASK_STATS_APP_TASKS)
+    {
+        g_app_tasks[g_app_task_count++] = task;
+    }
+}
+
+static uint8_t *put_be16(uint8_t *p, uint16_t value)
+{
+    p[0] = (value >> 8) & 0xFF;
+    p[1] = value & 0xFF;
+    return p + 2;
+}
+
+static uint8_t *put_be32(uint8_t *p, uint32_t value)
+{
+    p = put_be16(p, (uint16_t)(value >> 16));
+    return put_be16(p, (uint16_t)value);
+}
+
+// Tâche pas encore créée (idle et timers avant le scheduler) : enregistrement à zéro
+static uint8_t *put_record(uint8_t *p, TaskHandle_t task)
+{
+    if (task == NULL)
+    {
+        p = put_be16(p, 0);
+        return put_be32(p, 0);
+    }
+
+    p = put_be16(p, (uint16_t)uxTaskGetStackHighWaterMark(task));
+    return put_be32(p, (uint32_t)ulTaskGetRunTimeCounter(task));
+}
+
+// Appelé depuis l'ISR TWI, interruptions masquées : le bloc est cohérent.
+// Le calcul de la pile libre parcourt la partie jamais écrite de chaque pile
+// (~100 µs en tout sur la carte), le maître attend par clock stretching.
+uint8_t task_stats_snapshot(uint8_t *block)
+{
+    uint8_t *p = block;
+
+    *p++ = g_app_task_count + 2;
+    p = put_be32(p, (uint32_t)portGET_RUN_TIME_COUNTER_VALUE());
+
+    for (uint8_t i = 0; i < g_app_task_count; i++)
+    {
+        p = put_record(p, g_app_tasks[i]);
+    }
+    p = put_record(p, xTimerGetTimerDaemonTaskHandle());
+    p = put_record(p, xTaskGetIdleTaskHandle());
+
+    return (uint8_t)(p - block);
+}
+
+// ════════════════════════════════════════════════════════════════
+// Compteur de temps d'exécution (portGET_RUN_TIME_COUNTER_VALUE)
+// Le port ATMega328 le dérive déjà de Timer1 (tick) ; les autres
+// builds le fournissent ici, voir FreeRTOSConfig.h.
+// ════════════════════════════════════════════════════════════════
+
+#if defined(SIM_BUILD)
+
+void task_stats_counter_init(void)
+{
+}
+
+uint32_t task_stats_counter(void)
+{
+    return (uint32_t)hal_sim_time_us();
+}
+
+#elif defined(WDT_TICK)
+
+// Poids fort du compteur : débordements de Timer1 (un toutes les 1,05 s)
+static volatile uint16_t g_counter_high = 0;
+
+HAL_ISR(TIMER1_OVF_vect)
+{
+    g_counter_high++;
+}
+
+void task_stats_counter_init(void)
+{
+    hal_timer1_start_free_running();
+}
+
+uint32_t task_stats_counter(void)
+{
+    uint16_t high;
+    uint16_t low;
+
+    portENTER_CRITICAL();
+    high = g_counter_high;
+    low = hal_timer1_count();
+    // Débordement arrivé pendant la section critique, pas encore compté
+    if (hal_timer1_overflow_pending() && low < 0x8000)
+    {
+        high++;
+    }
+    portEXIT_CRITICAL();
+
+    return ((uint32_t)high << 16) | low;
+}
+
+#endif
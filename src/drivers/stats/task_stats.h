@@ -0,0 +1,46 @@
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+/*
+ * Statistiques par tâche publiées sur l'I2C (registre REG_TASK_STATS).
+ *
+ * Bloc big-endian lu d'une traite par le maître :
+ *   [0]      nombre de tâches N
+ *   [1..4]   compteur de temps d'exécution global (uint32)
+ *   puis N enregistrements de TASK_STATS_RECORD_SIZE octets, dans l'ordre
+ *   des task_stats_add() suivis de la tâche des timers et de la tâche idle :
+ *     [0..1] pile jamais utilisée depuis le démarrage (mots, uint16)
+ *     [2..5] temps d'exécution cumulé de la tâche (uint32)
+ *
+ * Les compteurs de temps bouclent sur 32 bits : la part CPU d'une tâche se
+ * calcule sur la différence entre deux lectures. L'unité est celle de
+ * portGET_RUN_TIME_COUNTER_VALUE() : 16 µs sur la carte, 1 µs en simulation.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Tâches de l'application + tâche des timers + tâche idle
+#define TASK_STATS_APP_TASKS 2
+#define TASK_STATS_MAX_TASKS (TASK_STATS_APP_TASKS + 2)
+
+#define TASK_STATS_RECORD_SIZE 6
+#define TASK_STATS_BLOCK_SIZE (1 + 4 + TASK_STATS_MAX_TASKS * TASK_STATS_RECORD_SIZE)
+
+    // Ajoute une tâche de l'application au bloc (avant le démarrage du scheduler)
+    void task_stats_add(TaskHandle_t task);
+
+    // Photographie le bloc (depuis l'ISR TWI), retourne sa longueur
+    uint8_t task_stats_snapshot(uint8_t *block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
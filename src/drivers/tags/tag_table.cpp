@@ -0,0 +1,254 @@
+#include "tag_table.h"
+#include "tag_hash.h"
+#include "hal/hal.h"
+#include "task.h"
+
+typedef struct
+{
+    char name[TAG_NAME_SIZE];
+    rfid_tag_t id;
+} tag_entry_t;
+
+typedef struct
+{
+    TickType_t last_seen;   // Dernière trame valide
+    TickType_t timer_start; // Départ du compte à rebours (TAG_TIMER_RUNNING)
+    uint8_t flags;
+} tag_state_t;
+
+#define TAG_ENTRY(name, b0, b1, b2, b3, b4) {name, {{b0, b1, b2, b3, b4}}},
+
+// Rangés par index : l'index d'un ID est donné par le hachage parfait minimal
+static const tag_entry_t g_entries[] HAL_PROGMEM = {TAG_TABLE(TAG_ENTRY)};
+static const uint8_t g_displacements[TAG_HASH_BUCKETS] HAL_PROGMEM = {TAG_HASH_DISPLACEMENTS};
+
+#define TAG_COUNT (sizeof(g_entries) / sizeof(g_entries[0]))
+
+static_assert(TAG_COUNT <= TAG_TABLE_MAX, "TAG_TABLE has more tags than the REG_TAG_MAP bitmaps");
+
+static tag_state_t g_tags[TAG_COUNT];
+
+#define ABSENCE_TICKS pdMS_TO_TICKS(TAG_ABSENCE_TIMEOUT_MS)
+#define SECURITY_TICKS pdMS_TO_TICKS(SECURITY_TIMEOUT_MS)
+
+void tag_table_init(TickType_t now)
+{
+    for (uint8_t i = 0; i < TAG_COUNT; i++)
+    {
+        g_tags[i].last_seen = now;
+        g_tags[i].flags = TAG_PRESENT;
+    }
+}
+
+uint8_t tag_table_count(void)
+{
+    return TAG_COUNT;
+}
+
+// Même calcul que tools/gen_tag_hash.py : un hachage FNV-1a de l'ID, un
+// déplacement lu en flash, puis une seule comparaison d'ID quel que soit le
+// nombre de tags
+uint8_t tag_table_find(const rfid_tag_t *id)
+{
+    uint32_t h = TAG_HASH_SEED;
+    for (uint8_t n = 0; n < RFID_TAG_ID_SIZE; n++)
+    {
+        h = (h ^ id->bytes[n]) * 16777619UL;
+    }
+
+    uint8_t d = hal_flash_read_byte(&g_displacements[(uint16_t)h % TAG_HASH_BUCKETS]);
+    uint32_t mixed = (h ^ (d * 0x9E3779B1UL)) * 0x85EBCA6BUL;
+    uint8_t index = (uint16_t)(mixed >> 16) % TAG_COUNT;
+
+    // Un ID hors de la table tombe aussi sur un index : il faut le vérifier
+    for (uint8_t n = 0; n < RFID_TAG_ID_SIZE; n++)
+    {
+        if (hal_flash_read_byte(&g_entries[index].id.bytes[n]) != id->bytes[n])
+        {
+            return TAG_NONE;
+        }
+    }
+    return index;
+}
+
+bool tag_table_seen(uint8_t index, TickType_t now)
+{
+    taskENTER_CRITICAL();
+    bool returned = !(g_tags[index].flags & TAG_PRESENT);
+    g_tags[index].last_seen = now;
+    g_tags[index].flags |= TAG_PRESENT;
+    taskEXIT_CRITICAL();
+    return returned;
+}
+
+uint8_t tag_table_expire_absent(TickType_t now, TickType_t *next)
+{
+    uint8_t missing = 0;
+
+    *next = 0;
+    for (uint8_t i = 0; i < TAG_COUNT; i++)
+    {
+        // Une trame peut arriver entre deux tags : section critique par tag
+        taskENTER_CRITICAL();
+        if (g_tags[i].flags & TAG_PRESENT)
+        {
+            TickType_t age = now - g_tags[i].last_seen;
+            if (age >= ABSENCE_TICKS)
+            {
+                g_tags[i].flags &= ~TAG_PRESENT;
+                missing++;
+            }
+            else if (*next == 0 || ABSENCE_TICKS - age < *next)
+            {
+                *next = ABSENCE_TICKS - age;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+    return missing;
+}
+
+uint8_t tag_table_flags(uint8_t index)
+{
+    return g_tags[index].flags;
+}
+
+uint16_t tag_table_map(uint8_t flags)
+{
+    uint16_t map = 0;
+
+    for (uint8_t i = 0; i < TAG_COUNT; i++)
+    {
+        if (g_tags[i].flags & flags)
+        {
+            map |= 1u << i;
+        }
+    }
+    return map;
+}
+
+uint8_t tag_table_status(void)
+{
+    uint8_t all = TAG_PRESENT;
+    uint8_t any = 0;
+
+    for (uint8_t i = 0; i < TAG_COUNT; i++)
+    {
+        all &= g_tags[i].flags;
+        any |= g_tags[i].flags;
+    }
+    return all | (any & (TAG_TIMER_RUNNING | TAG_ALARM_ACTIVE));
+}
+
+void tag_table_start_timer(uint8_t index, TickType_t now)
+{
+    taskENTER_CRITICAL();
+    g_tags[index].timer_start = now;
+    g_tags[index].flags |= TAG_TIMER_RUNNING;
+    taskEXIT_CRITICAL();
+}
+
+void tag_table_clear(uint8_t index, uint8_t flags)
+{
+    taskENTER_CRITICAL();
+    g_tags[index].flags &= ~flags;
+    taskEXIT_CRITICAL();
+}
+
+uint16_t tag_table_expire_timers(TickType_t now)
+{
+    uint16_t expired = 0;
+
+    taskENTER_CRITICAL();
+    for (uint8_t i = 0; i < TAG_COUNT; i++)
+    {
+        if ((g_tags[i].flags & TAG_TIMER_RUNNING) && (TickType_t)(now - g_tags[i].timer_start) >= SECURITY_TICKS)
+        {
+            g_tags[i].flags = (g_tags[i].flags & ~TAG_TIMER_RUNNING) | TAG_ALARM_ACTIVE;
+            expired |= 1u << i;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return expired;
+}
+
+// Ticks avant l'alarme du tag i (compte à rebours en cours)
+static TickType_t timer_left(uint8_t i, TickType_t now)
+{
+    TickType_t elapsed = now - g_tags[i].timer_start;
+    return elapsed >= SECURITY_TICKS ? 0 : SECURITY_TICKS - elapsed;
+}
+
+bool tag_table_next_timeout(TickType_t now, TickType_t *left)
+{
+    bool running = false;
+
+    for (uint8_t i = 0; i < TAG_COUNT; i++)
+    {
+        if (g_tags[i].flags & TAG_TIMER_RUNNING)
+        {
+            TickType_t ticks = timer_left(i, now);
+            if (!running || ticks < *left)
+            {
+                *left = ticks;
+            }
+            running = true;
+        }
+    }
+    return running;
+}
+
+uint8_t tag_table_name_from_isr(uint8_t index, uint8_t *block)
+{
+    for (uint8_t n = 0; n < TAG_NAME_SIZE; n++)
+    {
+        block[n] = hal_flash_read_byte(&g_entries[index].name[n]);
+    }
+    return TAG_NAME_SIZE;
+}
+
+static void put_u16(uint8_t *block, uint16_t value)
+{
+    block[0] = (value >> 8) & 0xFF;
+    block[1] = value & 0xFF;
+}
+
+uint8_t tag_table_snapshot_map_from_isr(uint8_t *block)
+{
+    block[TAG_MAP_COUNT] = TAG_COUNT;
+    put_u16(&block[TAG_MAP_PRESENT], tag_table_map(TAG_PRESENT));
+    put_u16(&block[TAG_MAP_TIMER], tag_table_map(TAG_TIMER_RUNNING));
+    put_u16(&block[TAG_MAP_ALARM], tag_table_map(TAG_ALARM_ACTIVE));
+    return TAG_MAP_SIZE;
+}
+
+uint8_t tag_table_snapshot_page_from_isr(uint8_t index, uint8_t *block)
+{
+    TickType_t now = xTaskGetTickCountFromISR();
+    const tag_state_t *tag = &g_tags[index];
+    TickType_t age = (now - tag->last_seen) / configTICK_RATE_HZ;
+    TickType_t left = 0;
+
+    if (tag->flags & TAG_TIMER_RUNNING)
+    {
+        // Arrondi au-dessus comme REG_TIMER_LEFT
+        left = (timer_left(index, now) + configTICK_RATE_HZ - 1) / configTICK_RATE_HZ;
+    }
+
+    block[TAG_PAGE_INDEX] = index;
+    block[TAG_PAGE_FLAGS] = tag->flags;
+    tag_table_name_from_isr(index, &block[TAG_PAGE_NAME]);
+#if configUSE_16_BIT_TICKS == 0
+    if (age > 0xFFFF)
+    {
+        age = 0xFFFF;
+    }
+#endif
+    put_u16(&block[TAG_PAGE_SEEN_AGE], (uint16_t)age);
+    put_u16(&block[TAG_PAGE_TIMER_LEFT], (uint16_t)left);
+    for (uint8_t n = 0; n < RFID_TAG_ID_SIZE; n++)
+    {
+        block[TAG_PAGE_ID + n] = hal_flash_read_byte(&g_entries[index].id.bytes[n]);
+    }
+    return TAG_PAGE_SIZE;
+}
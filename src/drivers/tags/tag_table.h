@@ -0,0 +1,97 @@
+#ifndef TAG_TABLE_H
+#define TAG_TABLE_H
+
+#include "FreeRTOS.h"
+#include "drivers/rfid/rfid_frame.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Table des tags surveillés par le nœud. tag_hash.h est généré au build par
+ * tools/gen_tag_hash.py depuis les "allowed_tags" du nœud dans
+ * rpi/data/arduinos_config.json (make NODE=<id>).
+ *
+ * Les noms, les ID et le hachage parfait minimal restent en flash ; seul
+ * l'état de chaque tag est en SRAM (5 octets par tag avec le tick 16 bits).
+ * L'index d'un tag est sa position dans TAG_TABLE, fixée par le hachage :
+ * c'est le champ tag des enregistrements de drivers/events et le bit du tag
+ * dans les bitmaps de REG_TAG_MAP.
+ *
+ * Propriétaires des champs :
+ *   - TAG_PRESENT et l'heure de la dernière trame : tâche ReadTag (présence)
+ *     et callback d'absence (départ) ;
+ *   - TAG_TIMER_RUNNING, TAG_ALARM_ACTIVE et le départ du compte à rebours :
+ *     tâche logique.
+ * Chaque modification se fait en section critique : l'ISR TWI lit toujours
+ * un état cohérent.
+ */
+
+#define TAG_TABLE_MAX        16   // Bits des bitmaps de REG_TAG_MAP
+#define TAG_NONE             0xFF // Tag absent de la table
+#define TAG_NAME_SIZE        8    // Nom complété par des 0 (7 caractères au plus)
+
+// Mêmes bits que REG_STATUS
+#define TAG_PRESENT          (1 << 0)
+#define TAG_TIMER_RUNNING    (1 << 1)
+#define TAG_ALARM_ACTIVE     (1 << 2)
+
+// Bloc REG_TAG_MAP (big-endian)
+#define TAG_MAP_COUNT        0    // Nombre de tags de la table
+#define TAG_MAP_PRESENT      1    // Bit i : tag i présent (uint16)
+#define TAG_MAP_TIMER        3    // Bit i : compte à rebours du tag i en cours (uint16)
+#define TAG_MAP_ALARM        5    // Bit i : alarme du tag i active (uint16)
+#define TAG_MAP_SIZE         7
+
+// Bloc REG_TAG_PAGE + i (big-endian)
+#define TAG_PAGE_INDEX       0    // i
+#define TAG_PAGE_FLAGS       1    // TAG_PRESENT | TAG_TIMER_RUNNING | TAG_ALARM_ACTIVE
+#define TAG_PAGE_NAME        2    // TAG_NAME_SIZE octets
+#define TAG_PAGE_SEEN_AGE    10   // Secondes depuis la dernière trame, modulo le tick (uint16)
+#define TAG_PAGE_TIMER_LEFT  12   // Secondes avant l'alarme, 0 sans compte à rebours (uint16)
+#define TAG_PAGE_ID          14   // ID 40 bits, RFID_TAG_ID_SIZE octets
+#define TAG_PAGE_SIZE        19
+
+    // Tous les tags supposés présents au démarrage, vus à l'instant now
+    void tag_table_init(TickType_t now);
+    uint8_t tag_table_count(void);
+
+    // Index du tag dans la table, TAG_NONE s'il n'y est pas (temps constant)
+    uint8_t tag_table_find(const rfid_tag_t *id);
+
+    // Trame valide du tag : retourne true s'il était absent
+    bool tag_table_seen(uint8_t index, TickType_t now);
+    // Déclare absents les tags sans trame depuis TAG_ABSENCE_TIMEOUT_MS, retourne
+    // leur nombre. *next : délai avant la prochaine échéance, 0 si aucun tag présent.
+    uint8_t tag_table_expire_absent(TickType_t now, TickType_t *next);
+
+    uint8_t tag_table_flags(uint8_t index);
+    // Bitmap des tags dont un des flags est levé
+    uint16_t tag_table_map(uint8_t flags);
+    // REG_STATUS du nœud : présent si tous les tags le sont, compte à rebours
+    // ou alarme si un tag au moins est dans cet état
+    uint8_t tag_table_status(void);
+
+    // Depuis la tâche logique
+    void tag_table_start_timer(uint8_t index, TickType_t now);
+    void tag_table_clear(uint8_t index, uint8_t flags);
+    // Passe en alarme les tags dont le compte à rebours SECURITY_TIMEOUT_MS est
+    // échu, retourne leur bitmap
+    uint16_t tag_table_expire_timers(TickType_t now);
+    // Délai avant la première échéance d'un compte à rebours, false s'il n'y en a aucun
+    bool tag_table_next_timeout(TickType_t now, TickType_t *left);
+
+    // Depuis l'ISR TWI (interruptions masquées), retournent le nombre d'octets
+    uint8_t tag_table_name_from_isr(uint8_t index, uint8_t *block);
+    uint8_t tag_table_snapshot_map_from_isr(uint8_t *block);
+    uint8_t tag_table_snapshot_page_from_isr(uint8_t index, uint8_t *block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
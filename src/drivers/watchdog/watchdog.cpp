@@ -0,0 +1,38 @@
+/*
+ * Watchdog of the WDT tick build (make wdt).
+ *
+ * The ThirdParty ATmega port drives the tick from the WDT interrupt. The tick
+ * hook switches it to interrupt + reset mode and re-arms the interrupt every
+ * period while the idle task keeps running; once the idle task has been
+ * starved for WATCHDOG_STALL_TIMEOUT_MS the interrupt is no longer re-armed
+ * and the next WDT time-out resets the node.
+ */
+
+#include "hal/hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define WATCHDOG_STALL_TICKS pdMS_TO_TICKS(WATCHDOG_STALL_TIMEOUT_MS)
+
+static_assert(WATCHDOG_STALL_TIMEOUT_MS * configTICK_RATE_HZ / 1000 <= 255,
+              "WATCHDOG_STALL_TIMEOUT_MS must fit in 255 ticks");
+
+// Single byte: written by the idle task, read by the tick ISR without locking
+static volatile uint8_t g_ticks_without_idle = 0;
+
+void vApplicationTickHook(void)
+{
+    if (g_ticks_without_idle < WATCHDOG_STALL_TICKS)
+    {
+        g_ticks_without_idle++;
+        hal_watchdog_rearm();
+    }
+}
+
+void vApplicationIdleHook(void)
+{
+    g_ticks_without_idle = 0;
+
+    // Woken up by the next tick (16 ms) or any other interrupt
+    hal_sleep_idle();
+}
@@ -0,0 +1,231 @@
+#ifndef HAL_AVR_H
+#define HAL_AVR_H
+
+/*
+ * ATmega328P backend of the HAL. Everything is static inline and resolves to
+ * constant register addresses, so led_on() still compiles to a single sbi.
+ */
+
+#include <stdbool.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <util/delay.h>
+
+// Déclare une routine d'interruption (ex: HAL_ISR(TWI_vect))
+#define HAL_ISR(vector) ISR(vector)
+
+// Fin d'une ISR qui a réveillé une tâche plus prioritaire (woken : le
+// pxHigherPriorityTaskWoken des API FromISR). A appeler en dernier dans l'ISR.
+#ifdef WDT_TICK
+#define HAL_YIELD_FROM_ISR(woken) do { if (woken) { portYIELD_FROM_ISR(); } } while (0)
+#else
+// Le port ATMega328 n'a pas de portYIELD_FROM_ISR : vPortYield() sauve le
+// contexte avec la pile de l'ISR, que la tâche interrompue dépile à sa reprise
+#define HAL_YIELD_FROM_ISR(woken) do { if (woken) { vPortYield(); } } while (0)
+#endif
+
+// Données constantes laissées en flash (lues avec hal_flash_read_*)
+#define HAL_PROGMEM PROGMEM
+
+static inline void hal_init(void)
+{
+    // Après un reset watchdog, WDE reste forcé tant que WDRF est à 1
+    MCUSR &= ~(1 << WDRF);
+    wdt_disable();
+}
+
+// ════════════════════════════════════════════════════════════════
+// GPIO
+// ════════════════════════════════════════════════════════════════
+
+static inline volatile uint8_t *hal_port_reg(hal_port_t port)
+{
+    switch (port)
+    {
+    case HAL_PORT_B:
+        return &PORTB;
+    case HAL_PORT_C:
+        return &PORTC;
+    default:
+        return &PORTD;
+    }
+}
+
+static inline volatile uint8_t *hal_ddr_reg(hal_port_t port)
+{
+    switch (port)
+    {
+    case HAL_PORT_B:
+        return &DDRB;
+    case HAL_PORT_C:
+        return &DDRC;
+    default:
+        return &DDRD;
+    }
+}
+
+static inline void hal_gpio_make_output(hal_port_t port, uint8_t mask)
+{
+    *hal_ddr_reg(port) |= mask;
+}
+
+static inline void hal_gpio_set(hal_port_t port, uint8_t mask)
+{
+    *hal_port_reg(port) |= mask;
+}
+
+static inline void hal_gpio_clear(hal_port_t port, uint8_t mask)
+{
+    *hal_port_reg(port) &= ~mask;
+}
+
+static inline void hal_gpio_toggle(hal_port_t port, uint8_t mask)
+{
+    *hal_port_reg(port) ^= mask;
+}
+
+// Sortie open-drain : la pin ne tire que vers 0, le niveau haut vient de la
+// résistance de pull-up externe (jamais de 5 V sur une entrée 3,3 V du Pi)
+static inline void hal_gpio_open_drain_low(hal_port_t port, uint8_t mask)
+{
+    *hal_port_reg(port) &= ~mask;
+    *hal_ddr_reg(port) |= mask;
+}
+
+static inline void hal_gpio_open_drain_release(hal_port_t port, uint8_t mask)
+{
+    *hal_ddr_reg(port) &= ~mask;
+    *hal_port_reg(port) &= ~mask;
+}
+
+// ════════════════════════════════════════════════════════════════
+// TWI (I2C) en mode slave
+// ════════════════════════════════════════════════════════════════
+
+static inline void hal_twi_slave_init(uint8_t address)
+{
+    TWAR = (address << 1);
+    TWCR = (1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+}
+
+static inline uint8_t hal_twi_status(void)
+{
+    return TWSR;
+}
+
+static inline uint8_t hal_twi_read(void)
+{
+    return TWDR;
+}
+
+static inline void hal_twi_write(uint8_t data)
+{
+    TWDR = data;
+}
+
+// Relâche le bus (TWINT) en continuant à répondre ACK
+static inline void hal_twi_ack(void)
+{
+    TWCR = (1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+}
+
+// Après une erreur de bus : STOP interne pour libérer les lignes, sans rien émettre
+static inline void hal_twi_recover(void)
+{
+    TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+}
+
+// ════════════════════════════════════════════════════════════════
+// USART0 en réception seule (RX = D0), 8N1, interruption USART_RX_vect
+// ════════════════════════════════════════════════════════════════
+
+static inline void hal_uart_init(uint32_t baud)
+{
+    uint16_t ubrr = (uint16_t)((F_CPU + 8UL * baud) / (16UL * baud) - 1);
+
+    UBRR0H = (uint8_t)(ubrr >> 8);
+    UBRR0L = (uint8_t)ubrr;
+    UCSR0A = 0;
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    UCSR0B = (1 << RXEN0) | (1 << RXCIE0);
+}
+
+// La lecture de UDR0 acquitte l'interruption
+static inline uint8_t hal_uart_read(void)
+{
+    return UDR0;
+}
+
+// ════════════════════════════════════════════════════════════════
+// Lecture de la flash
+// ════════════════════════════════════════════════════════════════
+
+static inline uint8_t hal_flash_read_byte(const void *addr)
+{
+    return pgm_read_byte(addr);
+}
+
+static inline uint16_t hal_flash_read_word(const void *addr)
+{
+    return pgm_read_word(addr);
+}
+
+// ════════════════════════════════════════════════════════════════
+// Watchdog et sommeil
+// ════════════════════════════════════════════════════════════════
+
+// Mode interruption + reset : le matériel efface WDIE à chaque timeout, et
+// le timeout suivant réinitialise le MCU si WDIE n'a pas été remis à 1.
+// Mettre WDE à 1 ne demande pas de séquence temporisée (niveau de sécurité 1).
+static inline void hal_watchdog_rearm(void)
+{
+    WDTCSR |= (1 << WDIE) | (1 << WDE);
+}
+
+// Mode idle : horloges des périphériques conservées, réveil sur toute interruption
+static inline void hal_sleep_idle(void)
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+}
+
+// ════════════════════════════════════════════════════════════════
+// Timer1 en comptage libre (build WDT : le tick ne l'utilise pas)
+// ════════════════════════════════════════════════════════════════
+
+// Mode normal, 16 MHz / 256 = 16 µs par pas, interruption TIMER1_OVF_vect toutes les 1,05 s
+static inline void hal_timer1_start_free_running(void)
+{
+    TCCR1A = 0;
+    TCCR1B = (1 << CS12);
+    TIFR1 = (1 << TOV1);
+    TIMSK1 |= (1 << TOIE1);
+}
+
+static inline uint16_t hal_timer1_count(void)
+{
+    return TCNT1;
+}
+
+// Débordement pas encore traité par TIMER1_OVF_vect (interruptions masquées)
+static inline bool hal_timer1_overflow_pending(void)
+{
+    return (TIFR1 & (1 << TOV1)) != 0;
+}
+
+// ════════════════════════════════════════════════════════════════
+// Temporisation bloquante
+// ════════════════════════════════════════════════════════════════
+
+static inline void hal_delay_ms(uint16_t ms)
+{
+    while (ms--)
+    {
+        _delay_ms(1);
+    }
+}
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef HAL_H
+#define HAL_H
+
+/*
+ * Thin hardware abstraction layer for the drivers.
+ *
+ * The firmware build (AVR) maps every call onto the ATmega328P registers with
+ * static inline functions, so the generated code is the same as direct
+ * register accesses. The host simulation build (SIM_BUILD) backs the same API
+ * with in-memory peripheral models (see hal/sim/).
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Ports GPIO utilisés par les drivers
+    typedef enum
+    {
+        HAL_PORT_B,
+        HAL_PORT_C,
+        HAL_PORT_D
+    } hal_port_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef SIM_BUILD
+#include "sim/hal_sim.h"
+#else
+#include "avr/hal_avr.h"
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SIM_SOFTWARE_SERIAL_H
+#define SIM_SOFTWARE_SERIAL_H
+
+/*
+ * Stand-in for the Arduino SoftwareSerial class in the host simulation.
+ * Only the subset used by the RFID driver is provided; received bytes come
+ * from the simulated UART fed by the scenario ("rfid" command).
+ */
+
+#include "hal/hal.h"
+
+class SoftwareSerial
+{
+public:
+    SoftwareSerial(uint8_t, uint8_t, bool = false) {}
+
+    void begin(long) {}
+    int available() { return hal_sim_uart_available(); }
+    int read() { return hal_sim_uart_read(); }
+};
+
+#endif
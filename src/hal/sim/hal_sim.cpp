@@ -0,0 +1,334 @@
+#include "hal/hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+// Codes TWSR (masqués) générés par le modèle TWI, cf. docs/TWI_I2C_REFERENCE.md
+#define SIM_TW_SR_SLA_ACK   0x60
+#define SIM_TW_SR_DATA_ACK  0x80
+#define SIM_TW_SR_STOP      0xA0
+#define SIM_TW_ST_SLA_ACK   0xA8
+#define SIM_TW_ST_DATA_ACK  0xB8
+#define SIM_TW_ST_DATA_NACK 0xC0
+#define SIM_TW_NO_INFO      0xF8
+
+#define SIM_UART_BUFFER_SIZE 64 // Même taille que le buffer RX de SoftwareSerial
+
+static const char g_port_names[] = {'B', 'C', 'D'};
+static uint8_t g_port[3];
+static uint8_t g_ddr[3];
+static uint8_t g_open_drain_low[3];
+
+static bool g_twi_enabled = false;
+static uint8_t g_twi_address = 0;
+static uint8_t g_twi_status = SIM_TW_NO_INFO;
+static uint8_t g_twi_data = 0;
+
+static uint8_t g_uart_buffer[SIM_UART_BUFFER_SIZE];
+static uint8_t g_uart_head = 0;
+static uint8_t g_uart_tail = 0;
+static bool g_usart_enabled = false;
+static uint8_t g_usart_data = 0;
+
+// ════════════════════════════════════════════════════════════════
+// Horodatage et traces
+// ════════════════════════════════════════════════════════════════
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+uint64_t hal_sim_time_us(void)
+{
+    static uint64_t origin = 0;
+    uint64_t now = monotonic_us();
+
+    if (origin == 0)
+    {
+        origin = now;
+    }
+    return now - origin;
+}
+
+// Les tâches sont des pthreads : les traces sont faites avec le tick masqué
+// pour qu'un changement de contexte ne survienne jamais au milieu de stdio.
+void hal_sim_log(const char *fmt, ...)
+{
+    va_list args;
+
+    taskENTER_CRITICAL();
+    printf("[%10llu us | tick %5lu] ", (unsigned long long)hal_sim_time_us(), (unsigned long)xTaskGetTickCount());
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+    fflush(stdout);
+    taskEXIT_CRITICAL();
+}
+
+// ════════════════════════════════════════════════════════════════
+// GPIO
+// ════════════════════════════════════════════════════════════════
+
+static void gpio_write(hal_port_t port, uint8_t value)
+{
+    uint8_t changed = (g_port[port] ^ value) & g_ddr[port];
+
+    g_port[port] = value;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+        if (changed & (1 << bit))
+        {
+            hal_sim_log("PORT%c.%u=%u", g_port_names[port], bit, (value >> bit) & 1);
+        }
+    }
+}
+
+void hal_gpio_make_output(hal_port_t port, uint8_t mask)
+{
+    g_ddr[port] |= mask;
+}
+
+void hal_gpio_set(hal_port_t port, uint8_t mask)
+{
+    gpio_write(port, g_port[port] | mask);
+}
+
+void hal_gpio_clear(hal_port_t port, uint8_t mask)
+{
+    gpio_write(port, g_port[port] & ~mask);
+}
+
+void hal_gpio_toggle(hal_port_t port, uint8_t mask)
+{
+    gpio_write(port, g_port[port] ^ mask);
+}
+
+uint8_t hal_sim_gpio_get(hal_port_t port)
+{
+    return g_port[port];
+}
+
+static void open_drain_write(hal_port_t port, uint8_t low)
+{
+    uint8_t changed = g_open_drain_low[port] ^ low;
+
+    g_open_drain_low[port] = low;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+        if (changed & (1 << bit))
+        {
+            hal_sim_log("PORT%c.%u=%u (open-drain)", g_port_names[port], bit, (low >> bit) & 1 ? 0 : 1);
+        }
+    }
+}
+
+void hal_gpio_open_drain_low(hal_port_t port, uint8_t mask)
+{
+    open_drain_write(port, g_open_drain_low[port] | mask);
+}
+
+void hal_gpio_open_drain_release(hal_port_t port, uint8_t mask)
+{
+    open_drain_write(port, g_open_drain_low[port] & ~mask);
+}
+
+uint8_t hal_sim_gpio_line(hal_port_t port)
+{
+    return ~g_open_drain_low[port];
+}
+
+// ════════════════════════════════════════════════════════════════
+// TWI (I2C) en mode slave
+// ════════════════════════════════════════════════════════════════
+
+void hal_twi_slave_init(uint8_t address)
+{
+    g_twi_address = address;
+    g_twi_enabled = true;
+}
+
+uint8_t hal_twi_status(void)
+{
+    return g_twi_status;
+}
+
+uint8_t hal_twi_read(void)
+{
+    return g_twi_data;
+}
+
+void hal_twi_write(uint8_t data)
+{
+    g_twi_data = data;
+}
+
+void hal_twi_ack(void)
+{
+    g_twi_status = SIM_TW_NO_INFO;
+}
+
+void hal_twi_recover(void)
+{
+    g_twi_status = SIM_TW_NO_INFO;
+}
+
+// Une ISR a réveillé une tâche plus prioritaire pendant la section critique
+static bool g_yield_pending = false;
+
+void hal_sim_yield_from_isr(bool woken)
+{
+    g_yield_pending = g_yield_pending || woken;
+}
+
+// Lève l'interruption TWI comme le ferait le matériel après un évènement bus
+static void twi_raise(uint8_t status)
+{
+    g_twi_status = status;
+    hal_sim_isr_TWI_vect();
+}
+
+// Sortie de la section critique où l'ISR a été levée, puis le changement de
+// contexte qu'elle a demandé, comme au reti sur la cible
+static void isr_exit(void)
+{
+    taskEXIT_CRITICAL();
+    if (g_yield_pending)
+    {
+        g_yield_pending = false;
+        taskYIELD();
+    }
+}
+
+bool hal_sim_twi_master_write(uint8_t address, const uint8_t *data, uint8_t len)
+{
+    if (!g_twi_enabled || address != g_twi_address)
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    twi_raise(SIM_TW_SR_SLA_ACK);
+    for (uint8_t i = 0; i < len; i++)
+    {
+        g_twi_data = data[i];
+        twi_raise(SIM_TW_SR_DATA_ACK);
+    }
+    twi_raise(SIM_TW_SR_STOP);
+    isr_exit();
+    return true;
+}
+
+// Equivalent de read_i2c_block_data : écriture du registre, START répété, lecture
+bool hal_sim_twi_master_read(uint8_t address, uint8_t reg, uint8_t *data, uint8_t len)
+{
+    if (!g_twi_enabled || address != g_twi_address)
+    {
+        return false;
+    }
+
+    taskENTER_CRITICAL();
+    twi_raise(SIM_TW_SR_SLA_ACK);
+    g_twi_data = reg;
+    twi_raise(SIM_TW_SR_DATA_ACK);
+    twi_raise(SIM_TW_SR_STOP); // Le START répété est signalé avec le même code
+    for (uint8_t i = 0; i < len; i++)
+    {
+        twi_raise(i == 0 ? SIM_TW_ST_SLA_ACK : SIM_TW_ST_DATA_ACK);
+        data[i] = g_twi_data;
+    }
+    twi_raise(SIM_TW_ST_DATA_NACK);
+    isr_exit();
+    return true;
+}
+
+// ════════════════════════════════════════════════════════════════
+// Liaison série du lecteur RFID
+// ════════════════════════════════════════════════════════════════
+
+// Vecteur par défaut si aucun driver ne fournit USART_RX_vect (comme __bad_interrupt)
+extern "C" __attribute__((weak)) void hal_sim_isr_USART_RX_vect(void)
+{
+}
+
+void hal_uart_init(uint32_t)
+{
+    g_usart_enabled = true;
+}
+
+uint8_t hal_uart_read(void)
+{
+    return g_usart_data;
+}
+
+void hal_sim_uart_push(uint8_t byte)
+{
+    taskENTER_CRITICAL();
+    if (g_usart_enabled)
+    {
+        g_usart_data = byte;
+        hal_sim_isr_USART_RX_vect();
+        isr_exit();
+        return;
+    }
+
+    uint8_t next = (g_uart_tail + 1) % SIM_UART_BUFFER_SIZE;
+    if (next != g_uart_head) // Octet perdu si le buffer est plein (comme SoftwareSerial)
+    {
+        g_uart_buffer[g_uart_tail] = byte;
+        g_uart_tail = next;
+    }
+    taskEXIT_CRITICAL();
+}
+
+int hal_sim_uart_available(void)
+{
+    taskENTER_CRITICAL();
+    int count = (g_uart_tail + SIM_UART_BUFFER_SIZE - g_uart_head) % SIM_UART_BUFFER_SIZE;
+    taskEXIT_CRITICAL();
+    return count;
+}
+
+int hal_sim_uart_read(void)
+{
+    int byte = -1;
+
+    taskENTER_CRITICAL();
+    if (g_uart_head != g_uart_tail)
+    {
+        byte = g_uart_buffer[g_uart_head];
+        g_uart_head = (g_uart_head + 1) % SIM_UART_BUFFER_SIZE;
+    }
+    taskEXIT_CRITICAL();
+    return byte;
+}
+
+// ════════════════════════════════════════════════════════════════
+// Temporisation bloquante
+// ════════════════════════════════════════════════════════════════
+
+// Attente active comme _delay_ms : le temps écoulé est du temps réel, même si
+// la tâche est préemptée par le tick pendant l'attente.
+void hal_delay_ms(uint16_t ms)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+    }
+}
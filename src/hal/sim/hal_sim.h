@@ -0,0 +1,108 @@
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+/*
+ * Host simulation backend of the HAL (FreeRTOS POSIX port).
+ *
+ * Peripherals are in-memory models implemented in hal_sim.cpp. Interrupt
+ * vectors become plain functions named hal_sim_isr_<vector> that the models
+ * call from the scenario task with the scheduler tick masked.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Numéros de bits des ports de l'ATmega328P (normalement fournis par <avr/io.h>)
+#define PB0 0
+#define PB5 5
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+// Pas d'espace d'adressage séparé pour la flash sur l'hôte
+#define HAL_PROGMEM
+
+#ifdef __cplusplus
+#define HAL_ISR(vector) extern "C" void hal_sim_isr_##vector(void)
+#else
+#define HAL_ISR(vector) void hal_sim_isr_##vector(void)
+#endif
+
+// Les ISR simulées tournent en section critique dans la tâche du scénario :
+// le changement de contexte est fait à la sortie de la section
+#define HAL_YIELD_FROM_ISR(woken) hal_sim_yield_from_isr((woken) != 0)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    // Initialisation : charge le scénario (stdin) et crée la tâche de stimulation
+    void hal_init(void);
+    void hal_sim_yield_from_isr(bool woken);
+
+    // GPIO
+    void hal_gpio_make_output(hal_port_t port, uint8_t mask);
+    void hal_gpio_set(hal_port_t port, uint8_t mask);
+    void hal_gpio_clear(hal_port_t port, uint8_t mask);
+    void hal_gpio_toggle(hal_port_t port, uint8_t mask);
+    uint8_t hal_sim_gpio_get(hal_port_t port);
+
+    // Sorties open-drain, avec une pull-up externe sur la ligne
+    void hal_gpio_open_drain_low(hal_port_t port, uint8_t mask);
+    void hal_gpio_open_drain_release(hal_port_t port, uint8_t mask);
+    // Niveau des lignes open-drain (1 : relâchée)
+    uint8_t hal_sim_gpio_line(hal_port_t port);
+
+    // TWI (I2C) en mode slave
+    void hal_twi_slave_init(uint8_t address);
+    uint8_t hal_twi_status(void);
+    uint8_t hal_twi_read(void);
+    void hal_twi_write(uint8_t data);
+    void hal_twi_ack(void);
+    void hal_twi_recover(void);
+
+    // Côté maître du bus simulé : retourne false si l'adresse ne répond pas
+    bool hal_sim_twi_master_write(uint8_t address, const uint8_t *data, uint8_t len);
+    bool hal_sim_twi_master_read(uint8_t address, uint8_t reg, uint8_t *data, uint8_t len);
+
+    // USART0 en réception seule : chaque octet poussé lève USART_RX_vect
+    void hal_uart_init(uint32_t baud);
+    uint8_t hal_uart_read(void);
+
+    // Liaison série du lecteur RFID (USART si hal_uart_init() a été appelé,
+    // sinon buffer lu par le remplaçant de SoftwareSerial)
+    void hal_sim_uart_push(uint8_t byte);
+    int hal_sim_uart_available(void);
+    int hal_sim_uart_read(void);
+
+    // Lecture de la flash
+    static inline uint8_t hal_flash_read_byte(const void *addr)
+    {
+        return *(const uint8_t *)addr;
+    }
+
+    static inline uint16_t hal_flash_read_word(const void *addr)
+    {
+        return *(const uint16_t *)addr;
+    }
+
+    // Temporisation bloquante
+    void hal_delay_ms(uint16_t ms);
+
+    // Horodatage de la simulation en microsecondes depuis le démarrage
+    uint64_t hal_sim_time_us(void);
+    void hal_sim_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+    // Routines d'interruption fournies par les drivers
+    void hal_sim_isr_TWI_vect(void);
+    void hal_sim_isr_USART_RX_vect(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,233 @@
+/*
+ * Scenario runner of the host simulation.
+ *
+ * The scenario is read from stdin before the scheduler starts and replayed by
+ * a high priority task, one command per line:
+ *
+ *   sleep <ms>                 wait (vTaskDelay)
+ *   rfid <hex bytes...>        bytes sent by the RFID reader
+ *   tag <10 hex chars>         well-formed reader frame for this tag ID
+ *   i2c_write <hex bytes...>   master write (first byte = register)
+ *   i2c_read <reg> <len>       master read, bytes are printed
+ *   expect <reg> <hex bytes>   master read, compared with the given bytes
+ *   attention <0|1>            expect the attention line released / asserted
+ *   quit                       stop the simulation
+ *
+ * Everything after a '#' is a comment and empty lines are ignored. At the end
+ * of the scenario the process exits with 1 if any check failed, 0 otherwise.
+ * When stdin is a terminal no scenario is loaded and the firmware runs freely
+ * (useful under gdb).
+ */
+
+#include "hal/hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "drivers/i2c/i2c_slave.h"
+#include "drivers/rfid/rfid_frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_MAX_BYTES 32
+
+static char **g_lines = NULL;
+static size_t g_line_count = 0;
+static unsigned g_failures = 0;
+
+static StaticTask_t g_scenario_tcb;
+static StackType_t g_scenario_stack[configMINIMAL_STACK_SIZE];
+
+static uint8_t parse_bytes(char *args, uint8_t *bytes)
+{
+    uint8_t count = 0;
+
+    for (char *tok = strtok(args, " \t"); tok != NULL && count < SIM_MAX_BYTES; tok = strtok(NULL, " \t"))
+    {
+        bytes[count++] = (uint8_t)strtoul(tok, NULL, 16);
+    }
+    return count;
+}
+
+static void format_bytes(const uint8_t *bytes, uint8_t len, char *out)
+{
+    out[0] = '\0';
+    for (uint8_t i = 0; i < len; i++)
+    {
+        sprintf(out + 3 * i, "%02X ", bytes[i]);
+    }
+}
+
+// STX, ID en ASCII, XOR des 5 octets de l'ID en ASCII, ETX
+static void send_tag_frame(size_t lineno, const char *id)
+{
+    char checksum_text[3];
+    uint8_t checksum = 0;
+
+    if (strlen(id) != 2 * RFID_TAG_ID_SIZE || strspn(id, "0123456789abcdefABCDEF") != 2 * RFID_TAG_ID_SIZE)
+    {
+        hal_sim_log("line %zu: tag ID must be %u hex chars", lineno, 2 * RFID_TAG_ID_SIZE);
+        g_failures++;
+        return;
+    }
+
+    for (uint8_t i = 0; i < RFID_TAG_ID_SIZE; i++)
+    {
+        char byte_text[3] = {id[2 * i], id[2 * i + 1], '\0'};
+        checksum ^= (uint8_t)strtoul(byte_text, NULL, 16);
+    }
+    snprintf(checksum_text, sizeof(checksum_text), "%02X", checksum);
+
+    hal_sim_uart_push(RFID_FRAME_STX);
+    for (const char *c = id; *c != '\0'; c++)
+    {
+        hal_sim_uart_push((uint8_t)*c);
+    }
+    hal_sim_uart_push((uint8_t)checksum_text[0]);
+    hal_sim_uart_push((uint8_t)checksum_text[1]);
+    hal_sim_uart_push(RFID_FRAME_ETX);
+}
+
+static void sim_quit(void)
+{
+    hal_sim_log("scenario done, %u failure(s)", g_failures);
+    exit(g_failures ? 1 : 0);
+}
+
+static void run_command(size_t lineno, char *line)
+{
+    uint8_t bytes[SIM_MAX_BYTES];
+    uint8_t got[SIM_MAX_BYTES];
+    char text[3 * SIM_MAX_BYTES + 1];
+    char text_got[3 * SIM_MAX_BYTES + 1];
+
+    char *cmd = strtok(line, " \t");
+    char *args = strtok(NULL, "");
+    if (args == NULL)
+    {
+        args = line + strlen(line); // Chaîne vide
+    }
+
+    if (strcmp(cmd, "sleep") == 0)
+    {
+        vTaskDelay(pdMS_TO_TICKS(strtoul(args, NULL, 10)));
+    }
+    else if (strcmp(cmd, "rfid") == 0)
+    {
+        uint8_t len = parse_bytes(args, bytes);
+        for (uint8_t i = 0; i < len; i++)
+        {
+            hal_sim_uart_push(bytes[i]);
+        }
+    }
+    else if (strcmp(cmd, "tag") == 0)
+    {
+        char *id = strtok(args, " \t");
+        send_tag_frame(lineno, id != NULL ? id : "");
+    }
+    else if (strcmp(cmd, "i2c_write") == 0)
+    {
+        uint8_t len = parse_bytes(args, bytes);
+        if (!hal_sim_twi_master_write(I2C_SLAVE_ADDRESS, bytes, len))
+        {
+            hal_sim_log("line %zu: i2c_write NACK", lineno);
+        }
+    }
+    else if (strcmp(cmd, "i2c_read") == 0 || strcmp(cmd, "expect") == 0)
+    {
+        bool expect = (cmd[0] == 'e');
+        uint8_t len = parse_bytes(args, bytes);
+        if (len == 0)
+        {
+            hal_sim_log("line %zu: missing register", lineno);
+            g_failures++;
+            return;
+        }
+
+        uint8_t reg = bytes[0];
+        uint8_t read_len = expect ? len - 1 : (len > 1 ? bytes[1] : 1);
+        if (read_len > SIM_MAX_BYTES)
+        {
+            read_len = SIM_MAX_BYTES;
+        }
+        hal_sim_twi_master_read(I2C_SLAVE_ADDRESS, reg, got, read_len);
+        format_bytes(got, read_len, text_got);
+
+        if (!expect)
+        {
+            hal_sim_log("i2c_read %02X: %s", reg, text_got);
+        }
+        else if (memcmp(got, bytes + 1, read_len) != 0)
+        {
+            format_bytes(bytes + 1, read_len, text);
+            hal_sim_log("line %zu: FAIL expect %02X: %s(got %s)", lineno, reg, text, text_got);
+            g_failures++;
+        }
+        else
+        {
+            hal_sim_log("expect %02X: ok", reg);
+        }
+    }
+    else if (strcmp(cmd, "attention") == 0)
+    {
+        bool expected = strtoul(args, NULL, 10) != 0;
+        bool asserted = !(hal_sim_gpio_line(I2C_ATTENTION_PORT) & (1 << I2C_ATTENTION_PIN));
+        if (asserted != expected)
+        {
+            hal_sim_log("line %zu: FAIL attention %u (got %u)", lineno, expected, asserted);
+            g_failures++;
+        }
+        else
+        {
+            hal_sim_log("attention %u: ok", expected);
+        }
+    }
+    else if (strcmp(cmd, "quit") == 0)
+    {
+        sim_quit();
+    }
+    else
+    {
+        hal_sim_log("line %zu: unknown command '%s'", lineno, cmd);
+        g_failures++;
+    }
+}
+
+static void vTaskScenario(void *)
+{
+    for (size_t i = 0; i < g_line_count; i++)
+    {
+        char *line = g_lines[i];
+        line[strcspn(line, "#\r\n")] = '\0';
+        if (line[strspn(line, " \t")] == '\0')
+        {
+            continue;
+        }
+        run_command(i + 1, line);
+    }
+    sim_quit();
+}
+
+void hal_init(void)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    hal_sim_time_us(); // Origine des horodatages
+
+    if (isatty(STDIN_FILENO))
+    {
+        return;
+    }
+
+    while (getline(&line, &capacity, stdin) != -1)
+    {
+        g_lines = (char **)realloc(g_lines, (g_line_count + 1) * sizeof(char *));
+        g_lines[g_line_count++] = strdup(line);
+    }
+    free(line);
+
+    xTaskCreateStatic(vTaskScenario, "Scenario", configMINIMAL_STACK_SIZE, NULL, configMAX_PRIORITIES - 1,
+                      g_scenario_stack, &g_scenario_tcb);
+}
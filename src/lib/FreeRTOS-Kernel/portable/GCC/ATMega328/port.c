@@ -36,6 +36,7 @@ Changes from V2.6.0
 
 #include <stdlib.h>
 #include <avr/interrupt.h>
+#include <avr/sleep.h>
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -50,9 +51,20 @@ Changes from V2.6.0
 /* Hardware constants for timer 1. */
 
 #define portCLEAR_COUNTER_ON_MATCH              ( ( unsigned char ) _BV(WGM12) )
-#define portPRESCALE_64                         ( ( unsigned char ) (_BV(CS11) | _BV(CS10)) )
-#define portCLOCK_PRESCALER                     ( ( unsigned long ) 64 )
+#if configUSE_TICKLESS_IDLE == 1
+	/* /256 gives a whole number of counts per tick at 16 MHz / 100 Hz (625)
+	and lets a suppressed tick period last up to 1 s in 16 bits. */
+	#define portPRESCALE                        ( ( unsigned char ) _BV(CS12) )
+	#define portCLOCK_PRESCALER                 ( ( unsigned long ) 256 )
+#else
+	#define portPRESCALE                        ( ( unsigned char ) (_BV(CS11) | _BV(CS10)) )
+	#define portCLOCK_PRESCALER                 ( ( unsigned long ) 64 )
+#endif
 #define portCOMPARE_MATCH_A_INTERRUPT_ENABLE    ( ( unsigned char ) _BV(OCIE1A) )
+#define portCOMPARE_MATCH_B_INTERRUPT_ENABLE    ( ( unsigned char ) _BV(OCIE1B) )
+
+/* Timer 1 counts in one tick. */
+#define portTIMER_COUNTS_PER_TICK		( ( uint16_t ) ( configCPU_CLOCK_HZ / portCLOCK_PRESCALER / configTICK_RATE_HZ ) )
 
 /*-----------------------------------------------------------*/
 
@@ -382,7 +394,7 @@ uint8_t /*ucHighByte,*/ ucLowByte;
 
 	/* Setup clock source and compare match behaviour. */
 	TCCR1A &= ~(_BV(WGM11) | _BV(WGM10));
-	ucLowByte = portCLEAR_COUNTER_ON_MATCH | portPRESCALE_64;
+	ucLowByte = portCLEAR_COUNTER_ON_MATCH | portPRESCALE;
 	TCCR1B = ucLowByte;
 
 	/* Enable the interrupt - this is okay as interrupt are currently globally
@@ -420,5 +432,167 @@ uint8_t /*ucHighByte,*/ ucLowByte;
 	}
 #endif
 
+#if configUSE_TICKLESS_IDLE == 1
+
+/* Longest idle period that fits in TCNT1 (104 ticks at 16 MHz / 100 Hz). */
+#define portMAX_SUPPRESSED_TICKS		( ( TickType_t ) ( 0xFFFFUL / portTIMER_COUNTS_PER_TICK ) )
+
+/* Writing TCNT1 blocks a compare match on the next timer clock, so the
+counter is never restored closer than this to OCR1A. */
+#define portMAX_RESTORED_COUNT			( portTIMER_COUNTS_PER_TICK - 3 )
+
+/* Time spent asleep: whole ticks, and the remainder in timer counts. */
+static TickType_t xSleepTicks = 0;
+static uint16_t usSleepCounts = 0;
+
+/*
+ * Compare match B ends a suppressed tick period.  Nothing to do here: the
+ * tick count is corrected by vPortSuppressTicksAndSleep() once awake.
+ */
+EMPTY_INTERRUPT( TIMER1_COMPB_vect )
+
+/*
+ * Called by the idle task with the scheduler suspended.  Timer 1 keeps
+ * counting from the last tick up to the next expected unblock time, and the
+ * CPU sleeps until compare match B or any other interrupt (TWI address match,
+ * RFID receive pin change or USART byte...).
+ *
+ * Idle is the deepest mode that keeps timer 1 clocked: power-save and
+ * power-down stop clkIO, the Uno has no 32 kHz crystal for timer 2, and the
+ * 16K cycle oscillator start-up would corrupt SoftwareSerial reception.
+ */
+void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+{
+uint16_t usStartCount, usCount, usSleptCount;
+TickType_t xCompleteTicks;
+
+	if( xExpectedIdleTime > portMAX_SUPPRESSED_TICKS )
+	{
+		xExpectedIdleTime = portMAX_SUPPRESSED_TICKS;
+	}
+
+	portDISABLE_INTERRUPTS();
+
+	/* A task was readied by an interrupt, or the tick is already pending:
+	let the tick interrupt run instead of sleeping. */
+	if( ( eTaskConfirmSleepModeStatus() == eAbortSleep ) || ( TIFR1 & _BV( OCF1A ) ) )
+	{
+		portENABLE_INTERRUPTS();
+		return;
+	}
+
+	/* Stop the timer while it is reprogrammed.  The counts elapsed since the
+	last tick are kept, the wake-up is set on the expected unblock tick. */
+	TCCR1B = portCLEAR_COUNTER_ON_MATCH;
+	usStartCount = TCNT1;
+	OCR1A = 0xFFFF;
+	OCR1B = ( uint16_t ) ( ( uint32_t ) xExpectedIdleTime * portTIMER_COUNTS_PER_TICK - 1UL );
+	TIFR1 = _BV( OCF1A ) | _BV( OCF1B );
+	TIMSK1 = ( TIMSK1 & ~portCOMPARE_MATCH_A_INTERRUPT_ENABLE ) | portCOMPARE_MATCH_B_INTERRUPT_ENABLE;
+	TCCR1B = portCLEAR_COUNTER_ON_MATCH | portPRESCALE;
+
+	set_sleep_mode( SLEEP_MODE_IDLE );
+	sleep_enable();
+
+	/* The instruction following sei is always executed before a pending
+	interrupt, so a wake-up source cannot be missed between the two. */
+	asm volatile ( "sei		\n\t"
+				   "sleep	\n\t" ::: "memory" );
+
+	/* The ISR of the wake-up source has already run. */
+	sleep_disable();
+	portDISABLE_INTERRUPTS();
+
+	TCCR1B = portCLEAR_COUNTER_ON_MATCH;
+	usCount = TCNT1;
+	usSleptCount = usCount - usStartCount;
+
+	/* Whole ticks elapsed since the last tick interrupt; the counter keeps
+	the fraction of the current tick. */
+	xCompleteTicks = ( TickType_t ) ( usCount / portTIMER_COUNTS_PER_TICK );
+	if( xCompleteTicks > xExpectedIdleTime )
+	{
+		xCompleteTicks = xExpectedIdleTime;
+	}
+	usCount -= ( uint16_t ) ( xCompleteTicks * portTIMER_COUNTS_PER_TICK );
+	if( usCount > portMAX_RESTORED_COUNT )
+	{
+		usCount = portMAX_RESTORED_COUNT;
+	}
+
+	/* Sleep statistics (see xPortGetSleepTickCount()). */
+	xSleepTicks += ( TickType_t ) ( usSleptCount / portTIMER_COUNTS_PER_TICK );
+	usSleepCounts += usSleptCount % portTIMER_COUNTS_PER_TICK;
+	if( usSleepCounts >= portTIMER_COUNTS_PER_TICK )
+	{
+		usSleepCounts -= portTIMER_COUNTS_PER_TICK;
+		xSleepTicks++;
+	}
+
+	/* Back to periodic ticks. */
+	TCNT1 = usCount;
+	OCR1A = portTIMER_COUNTS_PER_TICK - 1;
+	TIFR1 = _BV( OCF1A ) | _BV( OCF1B );
+	TIMSK1 = ( TIMSK1 & ~portCOMPARE_MATCH_B_INTERRUPT_ENABLE ) | portCOMPARE_MATCH_A_INTERRUPT_ENABLE;
+	TCCR1B = portCLEAR_COUNTER_ON_MATCH | portPRESCALE;
+
+	vTaskStepTick( xCompleteTicks );
+
+	portENABLE_INTERRUPTS();
+}
+/*-----------------------------------------------------------*/
+
+TickType_t xPortGetSleepTickCount( void )
+{
+	return xSleepTicks;
+}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
+
+#if configGENERATE_RUN_TIME_STATS == 1
+
+/* Tick count wraps seen by ulPortGetRunTimeCounterValue(). */
+static uint16_t usTickEpoch = 0;
+static TickType_t xLastTickCount = 0;
+
+/*
+ * Run time counter in timer 1 counts (16 us at /256): ticks since boot
+ * scaled by the tick period, plus the count reached in the current tick.
+ * Timer 1 already runs for the tick, so no other timer or interrupt is used.
+ *
+ * The 16-bit tick count is extended with the number of times it wrapped, so
+ * that the result wraps after 2^32 counts (19 h) like a real 32-bit counter.
+ * The kernel calls this on every context switch, much more often than the
+ * 655 s between two tick count wraps.
+ */
+uint32_t ulPortGetRunTimeCounterValue( void )
+{
+TickType_t xTicks;
+uint16_t usCount;
+uint32_t ulTicks;
+
+	portENTER_CRITICAL();
+	{
+		xTicks = xTaskGetTickCountFromISR();
+		usCount = TCNT1;
+
+		/* The counter restarted but the tick interrupt has not run yet. */
+		if( ( TIFR1 & _BV( OCF1A ) ) && ( usCount < ( portTIMER_COUNTS_PER_TICK / 2 ) ) )
+		{
+			xTicks++;
+		}
+
+		if( xTicks < xLastTickCount )
+		{
+			usTickEpoch++;
+		}
+		xLastTickCount = xTicks;
+		ulTicks = ( ( uint32_t ) usTickEpoch << 16 ) | xTicks;
+	}
+	portEXIT_CRITICAL();
+
+	return ulTicks * portTIMER_COUNTS_PER_TICK + usCount;
+}
 
-	
+#endif /* configGENERATE_RUN_TIME_STATS */
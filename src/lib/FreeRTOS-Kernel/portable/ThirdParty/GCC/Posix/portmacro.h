@@ -140,9 +140,12 @@ extern void vPortCancelThread( void * pxTaskToDelete );
  */
 #define portMEMORY_BARRIER()                        __asm volatile ( "" ::: "memory" )
 
-extern uint32_t ulPortGetRunTime( void );
-#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    /* no-op */
-#define portGET_RUN_TIME_COUNTER_VALUE()            ulPortGetRunTime()
+/* The application may provide its own run time counter in FreeRTOSConfig.h. */
+#ifndef portGET_RUN_TIME_COUNTER_VALUE
+    extern uint32_t ulPortGetRunTime( void );
+    #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    /* no-op */
+    #define portGET_RUN_TIME_COUNTER_VALUE()            ulPortGetRunTime()
+#endif
 
 /* *INDENT-OFF* */
 #ifdef __cplusplus
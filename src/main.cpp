@@ -1,59 +1,82 @@
 #include "FreeRTOS.h"
 #include "task.h"
-#include "queue.h"
 #include "timers.h"
-#include <avr/io.h>
-#include <avr/interrupt.h>
+#include "hal/hal.h"
 #include "drivers/buzzer/buzzer.h"
 #include "drivers/led/led.h"
 #include "drivers/rfid/rfid.h"
 #include "drivers/i2c/i2c_slave.h"
+#include "drivers/stats/task_stats.h"
+#include "drivers/events/event_fifo.h"
+#include "drivers/tags/tag_table.h"
+#include "drivers/commands/command_ring.h"
 
 
 RFID rfid(RFID_RX_PIN, RFID_TX_PIN); // Instantiate RFID object
 
 // Handles FreeRTOS
-QueueHandle_t xEventQueue;
+TaskHandle_t xLogicTask;
 TimerHandle_t xSecurityTimer;
-TaskHandle_t xAlarmTaskHandle = NULL;
+TimerHandle_t xAbsenceTimer;
 
+// The tag table (drivers/tags) holds the state of each tag: these events
+// only wake the logic task, which compares the table with what it last saw.
+// They are bits of the logic task notification value, so a burst never
+// fills a queue: an event posted while the same one is pending is merged
+// with it, and counted in REG_EVENT_SIGNALS. EVT_I2C_COMMAND is set by the
+// TWI ISR when the RPi finishes writing a command.
 typedef enum
 {
   EVT_TAG_MISSING,
   EVT_TAG_RETURNED,
   EVT_TIMER_EXPIRED,
-  EVT_I2C_COMMAND
+  EVT_I2C_COMMAND,
+  EVT_COUNT
 } SystemEvent_t;
 
+#define EVT_ALL_BITS ((1UL << EVT_COUNT) - 1)
+
+// Statically allocated kernel objects (no FreeRTOS heap, see the RAM map of the build)
+static StaticTimer_t xSecurityTimerBuffer;
+static StaticTimer_t xAbsenceTimerBuffer;
+static StaticTask_t xReadTagTCB;
+static StackType_t xReadTagStack[TASK_SENSOR_STACK_SIZE];
+static StaticTask_t xLogicTCB;
+static StackType_t xLogicStack[TASK_LOGIC_STACK_SIZE];
+
 static void vTaskReadTag(void *pvParameters);
 static void vTaskLogic(void *pvParameters);
-static void vTaskAlarm(void *pvParameters);
 static void vTimerCallback(TimerHandle_t xTimer);
+static void vAbsenceTimerCallback(TimerHandle_t xTimer);
+static void vPostEvent(SystemEvent_t evt);
 
 int main(void)
 {
 
   // Intialize hardware
+  hal_init();
   buzzer_init();
   led_init_all();
   rfid.init();
   i2c_slave_init();
   
-  // Initial LED and Buzzer patterns
+  // Initial LED and Buzzer patterns (played by the timer task once the scheduler runs)
   led_pattern_startup();
   buzzer_pattern_startup();
 
   // Create FreeRTOS objects
-  xEventQueue = xQueueCreate(3, sizeof(SystemEvent_t));
-  xSecurityTimer = xTimerCreate(NULL,pdMS_TO_TICKS(SECURITY_TIMEOUT_MS),pdFALSE,(void *)0,vTimerCallback);
+  xSecurityTimer = xTimerCreateStatic(NULL,pdMS_TO_TICKS(SECURITY_TIMEOUT_MS),pdFALSE,(void *)0,vTimerCallback,&xSecurityTimerBuffer);
+  xAbsenceTimer = xTimerCreateStatic(NULL,pdMS_TO_TICKS(TAG_ABSENCE_TIMEOUT_MS),pdFALSE,(void *)0,vAbsenceTimerCallback,&xAbsenceTimerBuffer);
 
-  // Create FreeRTOS tasks
-  xTaskCreate(vTaskReadTag, "ReadTag", 85, NULL, TASK_SENSOR_PRIORITY, NULL);
-  xTaskCreate(vTaskLogic, "Logic", 90, NULL, TASK_LOGIC_PRIORITY, NULL);
-  xTaskCreate(vTaskAlarm, "Alarm", 70, NULL, TASK_ALARM_PRIORITY, &xAlarmTaskHandle);
+  // Every tag is assumed present at boot and reported missing if no frame arrives in time
+  tag_table_init(xTaskGetTickCount());
+  xTimerStart(xAbsenceTimer, 0);
 
-  // Start with alarm task suspended
-  vTaskSuspend(xAlarmTaskHandle);
+  // Create FreeRTOS tasks (REG_TASK_STATS lists them in this order, then the timer and idle tasks)
+  task_stats_add(xTaskCreateStatic(vTaskReadTag, "ReadTag", TASK_SENSOR_STACK_SIZE, NULL, TASK_SENSOR_PRIORITY, xReadTagStack, &xReadTagTCB));
+  xLogicTask = xTaskCreateStatic(vTaskLogic, "Logic", TASK_LOGIC_STACK_SIZE, NULL, TASK_LOGIC_PRIORITY, xLogicStack, &xLogicTCB);
+  task_stats_add(xLogicTask);
+  i2c_slave_notify_on_command(xLogicTask, 1UL << EVT_I2C_COMMAND);
 
   // Start the scheduler
   vTaskStartScheduler();
@@ -64,145 +87,319 @@ int main(void)
 
 static void vTaskReadTag(void *)
 {
-  bool isTagPresent = true;
-  uint8_t missingCount = 0;
-  const uint8_t THRESHOLD = 5;
-
+  rfid_tag_t tag;
 
   for (;;)
   {
-    bool readSuccess = false;
-    // If the tag is detected, we read it
-    if (rfid.available())
+    // Sleeps until the reader path decodes a frame, unregistered tags are ignored
+    if (!rfid.wait_tag(&tag, portMAX_DELAY))
+    {
+      continue;
+    }
+    uint8_t index = tag_table_find(&tag);
+    if (index == TAG_NONE)
     {
-      rfid.read();
-      unsigned char *buffer = rfid.get_buffer();
+      continue;
+    }
 
-      if (buffer[0] != 0)
-      {
-        readSuccess = true;
-        rfid.clear();
-      }
+    bool returned = tag_table_seen(index, xTaskGetTickCount());
+    // One absence timer for the whole table, armed on the oldest frame: it
+    // only has to be started when no tag was present
+    if (!xTimerIsTimerActive(xAbsenceTimer))
+    {
+      xTimerChangePeriod(xAbsenceTimer, pdMS_TO_TICKS(TAG_ABSENCE_TIMEOUT_MS), 0);
     }
 
-    if (readSuccess)
+    // Send event only if the tag was previously missing
+    if (returned)
     {
-      missingCount = 0;
-      // Send event only if the tag was previously missing
-      if (!isTagPresent)
+      vPostEvent(EVT_TAG_RETURNED);
+    }
+  }
+}
+
+// Wakes the logic task; never blocks nor fails
+static void vPostEvent(SystemEvent_t evt)
+{
+  uint32_t ulPrevious;
+
+  xTaskNotifyAndQuery(xLogicTask, 1UL << evt, eSetBits, &ulPrevious);
+  i2c_slave_count_signal((ulPrevious & (1UL << evt)) != 0);
+}
+
+// Records pushed to the event FIFO since the logic task last counted them
+static bool bRecorded = false;
+
+static void vRecordEvent(event_type_t type, uint8_t tag)
+{
+  event_fifo_push(type, tag);
+  bRecorded = true;
+}
+
+// Security timer armed on the nearest countdown of the table, published in REG_TIMER_LEFT
+static void vRearmSecurityTimer(void)
+{
+  TickType_t left;
+
+  if (tag_table_next_timeout(xTaskGetTickCount(), &left))
+  {
+    xTimerChangePeriod(xSecurityTimer, left > 0 ? left : 1, 0);
+    i2c_slave_set_countdown(left);
+  }
+  else
+  {
+    xTimerStop(xSecurityTimer, 0);
+    i2c_slave_set_countdown(0);
+  }
+}
+
+// Tags that left or came back since the previous call. Returns true when a
+// countdown was started or stopped; *resolved: an alarm ended with the return
+// of its tag.
+static bool bUpdatePresence(uint16_t *known, bool *resolved)
+{
+  uint16_t present = tag_table_map(TAG_PRESENT);
+  uint16_t changed = present ^ *known;
+  bool timers = false;
+
+  *known = present;
+  for (uint8_t i = 0; i < tag_table_count(); i++)
+  {
+    if (!(changed & (1u << i)))
+    {
+      continue;
+    }
+
+    if (present & (1u << i))
+    {
+      vRecordEvent(EVENT_TAG_RETURNED, i);
+      uint8_t flags = tag_table_flags(i);
+      if (flags & TAG_TIMER_RUNNING)
+      {
+        // Case 1 : Returned BEFORE alarm -> Safe
+        tag_table_clear(i, TAG_TIMER_RUNNING);
+        timers = true;
+      }
+      else if (flags & TAG_ALARM_ACTIVE)
       {
-        isTagPresent = true;
-        SystemEvent_t evt = EVT_TAG_RETURNED;
-        xQueueSend(xEventQueue, &evt, 0);
+        // Case 2 : Returned AFTER alarm -> Resolved
+        tag_table_clear(i, TAG_ALARM_ACTIVE);
+        vRecordEvent(EVENT_ALARM_STOPPED, i);
+        *resolved = true;
       }
     }
     else
     {
-      missingCount++;
-      // Send event only if the tag was previously present and threshold is reached
-      if (missingCount >= THRESHOLD && isTagPresent)
-      {
-        isTagPresent = false;
-        if (missingCount > THRESHOLD)missingCount = THRESHOLD; // Prevent overflow
-        SystemEvent_t evt = EVT_TAG_MISSING;
-        xQueueSend(xEventQueue, &evt, 0);
-      }
+      vRecordEvent(EVENT_TAG_REMOVED, i);
+      tag_table_start_timer(i, xTaskGetTickCount());
+      timers = true;
     }
+  }
+  return timers;
+}
 
-    vTaskDelay(200 / portTICK_PERIOD_MS);
+// The RPi acknowledged the alarm of one tag, or of every tag
+static uint8_t ucStopAlarm(const command_t *cmd)
+{
+  uint16_t alarms = tag_table_map(TAG_ALARM_ACTIVE);
+
+  if (cmd->argc > 1 || (cmd->argc == 1 && cmd->args[0] >= tag_table_count()))
+  {
+    return CMD_RESULT_BAD_ARGS;
+  }
+  if (cmd->argc == 1)
+  {
+    alarms &= 1u << cmd->args[0];
+  }
+  for (uint8_t i = 0; i < tag_table_count(); i++)
+  {
+    if (alarms & (1u << i))
+    {
+      tag_table_clear(i, TAG_ALARM_ACTIVE);
+      vRecordEvent(EVENT_ALARM_ACKED, i);
+    }
+  }
+  return CMD_RESULT_OK;
+}
+
+// A write retried by the RPi after a failed ACK or PEC may bring back commands
+// already run: their seq is one of the last COMMAND_RING_LENGTH before the
+// last one run (seq 1..255, 0 is REG_COMMAND and never skipped)
+static bool bAlreadyRun(uint8_t seq, uint8_t lastSeq)
+{
+  if (seq == 0 || lastSeq == 0)
+  {
+    return false;
+  }
+  return (uint8_t)((lastSeq + 255 - seq) % 255) < COMMAND_RING_LENGTH;
+}
+
+// Commands written by the RPi, in the order they were received; the result
+// of each one is published with its sequence number in REG_COMMAND_RESULT
+static void vRunCommands(void)
+{
+  static uint8_t ucLastSeq = 0;
+  command_t cmd;
+
+  while (command_ring_pop(&cmd))
+  {
+    if (bAlreadyRun(cmd.seq, ucLastSeq))
+    {
+      continue;
+    }
+
+    uint8_t result;
+    switch (cmd.cmd)
+    {
+      case CMD_NOP:
+        result = CMD_RESULT_OK;
+        break;
+
+      case CMD_STOP_ALARM:
+        result = ucStopAlarm(&cmd);
+        break;
+
+      default:
+        result = CMD_RESULT_UNKNOWN;
+        break;
+    }
+    i2c_slave_command_done(cmd.seq, result);
+    ucLastSeq = cmd.seq;
+  }
+}
+
+// LEDs and buzzer for the state of the whole table: alarm on any tag, else
+// countdown on any tag, else green when every tag is in place. The steady
+// states are LED patterns too, so a pattern still playing (startup, success)
+// cannot switch them off when it ends.
+static void vShowStatus(uint8_t previous, uint8_t status, bool resolved)
+{
+  if (status & STATUS_ALARM_ACTIVE)
+  {
+    if (!(previous & STATUS_ALARM_ACTIVE))
+    {
+      led_pattern_alert();
+      buzzer_pattern_alert();
+    }
+    return;
+  }
+  if (previous & STATUS_ALARM_ACTIVE)
+  {
+    buzzer_pattern_stop();
+  }
+
+  if (status & STATUS_TIMER_RUNNING)
+  {
+    led_pattern_countdown();
+  }
+  else if (!(status & STATUS_TAG_PRESENT))
+  {
+    led_pattern_stop();
+  }
+  else if (resolved)
+  {
+    // Green blinks then stays on
+    led_pattern_success();
+  }
+  else
+  {
+    led_pattern_ready();
   }
 }
 
 
 static void vTaskLogic(void *)
 {
-  SystemEvent_t rxEvent;
-  bool timerRunning = false;
-  bool alarmActive = false;
-  i2c_slave_set_status(STATUS_TAG_PRESENT);
+  uint32_t ulEvents;
+  uint16_t knownPresent = tag_table_map(TAG_PRESENT);
+  uint8_t status = tag_table_status();
+  i2c_slave_set_status(status);
 
   for (;;)
   {
-    // Check I2C commands from the RPi (non-blocking)
-    uint8_t i2c_cmd = i2c_slave_get_pending_command();
-    if (i2c_cmd == CMD_STOP_ALARM && alarmActive) {
-      // The RPi acknowledged the alarm
-      vTaskSuspend(xAlarmTaskHandle);
-      buzzer_off();
-      led_all_off();
-      alarmActive = false;
-    }
+    bool timers = false;
+    bool resolved = false;
 
-    if (xQueueReceive(xEventQueue, &rxEvent, pdMS_TO_TICKS(100)) == pdPASS)
+    // Sleeps until a tag event, a timer expiry or a command from the RPi
+    xTaskNotifyWait(0, EVT_ALL_BITS, &ulEvents, portMAX_DELAY);
+    // Presence first: a tag back in time stops its countdown before the expiry is handled
+    for (uint8_t evt = 0; evt < EVT_COUNT; evt++)
     {
-      switch (rxEvent)
+      if (!(ulEvents & (1UL << evt)))
+      {
+        continue;
+      }
+      switch (evt)
       {
         case EVT_TAG_MISSING:
-          // Start the security timer only if not already running and alarm not active
-          if (!timerRunning && !alarmActive)
-          {
-            xTimerStart(xSecurityTimer, 0);
-            timerRunning = true;
-            led_off(LED_GREEN);
-            led_on(LED_BLUE);
-            i2c_slave_set_status(STATUS_TIMER_RUNNING);
-          }
+        case EVT_TAG_RETURNED:
+          timers |= bUpdatePresence(&knownPresent, &resolved);
           break;
 
-        case EVT_TAG_RETURNED:
-          if (timerRunning)
-          {
-            // Case 1 : Returned BEFORE alarm -> Safe
-            xTimerStop(xSecurityTimer, 0);
-            timerRunning = false;
-            // Visual indicator "Safe" (Green)
-            led_off(LED_BLUE);
-            led_on(LED_GREEN);
-            // I2C status update
-            i2c_slave_set_status(STATUS_TAG_PRESENT);
-          }
-          else if (alarmActive)
+        case EVT_TIMER_EXPIRED:
+        {
+          uint16_t expired = tag_table_expire_timers(xTaskGetTickCount());
+          for (uint8_t i = 0; i < tag_table_count(); i++)
           {
-            // Case 2 : Returned AFTER alarm -> Resolved
-            vTaskSuspend(xAlarmTaskHandle);
-            buzzer_off();
-            led_all_off();
-            alarmActive = false;
-            led_pattern_success();
-            led_on(LED_GREEN);
-            // I2C status update
-            i2c_slave_set_status(STATUS_TAG_PRESENT);
+            if (expired & (1u << i))
+            {
+              vRecordEvent(EVENT_ALARM_STARTED, i);
+            }
           }
+          timers = true;
           break;
-        case EVT_TIMER_EXPIRED:
-          timerRunning = false;
-          alarmActive = true;
-          vTaskResume(xAlarmTaskHandle);
-          // I2C status update
-          i2c_slave_set_status(STATUS_ALARM_ACTIVE);
-          break;
+        }
+
         case EVT_I2C_COMMAND:
-          // Handled outside the switch via i2c_slave_get_pending_command()
+          vRunCommands();
           break;
       }
     }
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+    // Once the records are in the FIFO: a gateway woken by the new generation
+    // always finds them to drain. A wakeup that recorded nothing (merged
+    // event, NOP command) leaves REG_GENERATION and the attention line alone.
+    if (bRecorded)
+    {
+      i2c_slave_count_event();
+      bRecorded = false;
+    }
+
+    if (timers)
+    {
+      vRearmSecurityTimer();
+    }
+
+    uint8_t newStatus = tag_table_status();
+    if (newStatus != status || resolved)
+    {
+      vShowStatus(status, newStatus, resolved);
+      status = newStatus;
+    }
+    // I2C status update
+    i2c_slave_set_status(status);
   }
 }
 
-static void vTaskAlarm(void *)
+static void vTimerCallback(TimerHandle_t)
 {
-  for (;;)
-  {
-    led_pattern_alert();
-    buzzer_pattern_alert();
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-  }
+  // Timer expired -> send event to logic task so he can activate the alarms
+  vPostEvent(EVT_TIMER_EXPIRED);
 }
 
-void vTimerCallback(TimerHandle_t xTimer)
+static void vAbsenceTimerCallback(TimerHandle_t)
 {
-  // Timer expired -> send event to logic task so he can activate the alarm
-  SystemEvent_t evt = EVT_TIMER_EXPIRED;
-  xQueueSend(xEventQueue, &evt, 0);
+  TickType_t next;
+
+  // Tags without a valid frame for TAG_ABSENCE_TIMEOUT_MS are missing; a frame
+  // seen after the expiry is kept by the table and re-arms the timer below
+  if (tag_table_expire_absent(xTaskGetTickCount(), &next) > 0)
+  {
+    vPostEvent(EVT_TAG_MISSING);
+  }
+
+  // Next tag to age out, if any is still present
+  if (next > 0)
+  {
+    xTimerChangePeriod(xAbsenceTimer, next, 0);
+  }
 }
@@ -0,0 +1,209 @@
+/*
+ * Event delivery to the logic task, before and after the task notifications:
+ * make bench && ./build/sim/event_bench
+ *
+ * Same priorities as the firmware: the producer (ReadTag / timer task) runs
+ * above the consumer (Logic), which handles an event as soon as the producer
+ * blocks again.
+ *
+ *   queue   xQueueSend(..., 0) into a 3-deep queue, xQueueReceive()
+ *   notify  xTaskNotifyAndQuery(eSetBits), xTaskNotifyWait()
+ *
+ * Latency: time from the post to the start of the handler, over
+ * BENCH_EVENTS single events. Burst: BENCH_BURST events posted without
+ * yielding, as when several tags leave at once; a queue drops what does not
+ * fit, the notification bits merge the events of the same type (the logic
+ * task re-reads the tag table, so no transition is lost) and the merges are
+ * counted. RAM: what the mechanism adds to the firmware; the notification
+ * value and state are part of every TCB already.
+ */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "hal/hal.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_EVENTS 2000
+#define BENCH_BURST 6
+#define BENCH_EVENT_TYPES 3 // EVT_TAG_MISSING, EVT_TAG_RETURNED, EVT_TIMER_EXPIRED
+#define QUEUE_LENGTH 3      // xEventQueue of the firmware before
+
+// Élément de la file comme SystemEvent_t dans main.cpp avant : un enum
+typedef enum
+{
+    BENCH_EVT_0
+} bench_event_t;
+
+typedef enum
+{
+    MODE_QUEUE,
+    MODE_NOTIFY
+} bench_mode_t;
+
+typedef struct
+{
+    uint64_t total_us;
+    uint64_t max_us;
+    uint32_t single; // Evénements de la mesure de latence
+    uint32_t handled;
+    uint32_t posted;
+    uint32_t dropped; // queue full
+    uint32_t merged;  // notification bit already set
+} bench_result_t;
+
+static bench_mode_t g_mode;
+static bench_result_t g_results[2];
+static volatile uint64_t g_posted_at;
+static volatile bool g_measure;
+
+static TaskHandle_t g_consumer;
+static QueueHandle_t g_queue;
+static StaticQueue_t g_queue_buffer;
+static uint8_t g_queue_storage[QUEUE_LENGTH * sizeof(bench_event_t)];
+static StaticTask_t g_producer_tcb;
+static StackType_t g_producer_stack[configMINIMAL_STACK_SIZE * 4];
+static StaticTask_t g_consumer_tcb;
+static StackType_t g_consumer_stack[configMINIMAL_STACK_SIZE * 4];
+
+// Le TWI n'est pas utilisé ici
+extern "C" void hal_sim_isr_TWI_vect(void)
+{
+}
+
+static void post(uint8_t evt)
+{
+    bench_result_t *result = &g_results[g_mode];
+
+    result->posted++;
+    if (g_mode == MODE_QUEUE)
+    {
+        bench_event_t item = (bench_event_t)evt;
+        if (xQueueSend(g_queue, &item, 0) != pdPASS)
+        {
+            result->dropped++;
+        }
+    }
+    else
+    {
+        uint32_t previous;
+        xTaskNotifyAndQuery(g_consumer, 1UL << evt, eSetBits, &previous);
+        if (previous & (1UL << evt))
+        {
+            result->merged++;
+        }
+    }
+}
+
+static void handled(void)
+{
+    bench_result_t *result = &g_results[g_mode];
+
+    if (g_measure)
+    {
+        uint64_t latency = hal_sim_time_us() - g_posted_at;
+        result->total_us += latency;
+        if (latency > result->max_us)
+        {
+            result->max_us = latency;
+        }
+    }
+    result->handled++;
+}
+
+static void consumer_task(void *)
+{
+    for (;;)
+    {
+        if (g_mode == MODE_QUEUE)
+        {
+            bench_event_t evt;
+            if (xQueueReceive(g_queue, &evt, portMAX_DELAY) == pdPASS && g_mode == MODE_QUEUE)
+            {
+                handled();
+            }
+        }
+        else
+        {
+            uint32_t events;
+            if (xTaskNotifyWait(0, 0xFFFFFFFFUL, &events, portMAX_DELAY) == pdPASS)
+            {
+                for (uint8_t evt = 0; evt < BENCH_EVENT_TYPES; evt++)
+                {
+                    if (events & (1UL << evt))
+                    {
+                        handled();
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void run(bench_mode_t mode)
+{
+    bench_result_t *result = &g_results[mode];
+
+    g_mode = mode;
+    if (mode == MODE_NOTIFY)
+    {
+        // Le consommateur attend encore sur la file : le réveiller une dernière fois
+        bench_event_t wake = BENCH_EVT_0;
+        xQueueSend(g_queue, &wake, 0);
+        vTaskDelay(1);
+    }
+
+    // Latence : un événement à la fois, le consommateur a fini avant le suivant
+    g_measure = true;
+    for (uint32_t i = 0; i < BENCH_EVENTS; i++)
+    {
+        g_posted_at = hal_sim_time_us();
+        post(i % BENCH_EVENT_TYPES);
+        vTaskDelay(1);
+    }
+    g_measure = false;
+    result->single = result->handled;
+
+    // Rafale : BENCH_BURST événements sans rendre la main
+    result->posted = result->dropped = result->merged = result->handled = 0;
+    for (uint8_t i = 0; i < BENCH_BURST; i++)
+    {
+        post(i % BENCH_EVENT_TYPES);
+    }
+    vTaskDelay(2);
+}
+
+static void producer_task(void *)
+{
+    run(MODE_QUEUE);
+    run(MODE_NOTIFY);
+
+    printf("%-8s %12s %10s %14s %14s %10s\n", "mode", "latency_us", "max_us", "burst_handled", "burst_dropped", "merged");
+    const char *names[] = {"queue", "notify"};
+    for (int mode = MODE_QUEUE; mode <= MODE_NOTIFY; mode++)
+    {
+        const bench_result_t *r = &g_results[mode];
+        printf("%-8s %12.1f %10llu %11lu/%-2d %14lu %10lu\n", names[mode],
+               r->single ? (double)r->total_us / r->single : 0.0,
+               (unsigned long long)r->max_us, (unsigned long)r->handled, BENCH_BURST,
+               (unsigned long)r->dropped, (unsigned long)r->merged);
+    }
+
+    printf("\nRAM added by the mechanism (host sizes; see the .ram map of the AVR build):\n");
+    printf("  queue   %zu bytes (StaticQueue_t %zu + storage %zu)\n",
+           sizeof(g_queue_buffer) + sizeof(g_queue_storage), sizeof(g_queue_buffer), sizeof(g_queue_storage));
+    printf("  notify  0 bytes (%d x uint32_t value + state byte, already in every TCB)\n",
+           configTASK_NOTIFICATION_ARRAY_ENTRIES);
+    exit(0);
+}
+
+int main(void)
+{
+    g_queue = xQueueCreateStatic(QUEUE_LENGTH, sizeof(bench_event_t), g_queue_storage, &g_queue_buffer);
+    xTaskCreateStatic(producer_task, "Producer", sizeof(g_producer_stack) / sizeof(StackType_t), NULL,
+                      tskIDLE_PRIORITY + 3, g_producer_stack, &g_producer_tcb);
+    g_consumer = xTaskCreateStatic(consumer_task, "Consumer", sizeof(g_consumer_stack) / sizeof(StackType_t), NULL,
+                                   tskIDLE_PRIORITY + 2, g_consumer_stack, &g_consumer_tcb);
+    vTaskStartScheduler();
+    return 0;
+}
@@ -0,0 +1,169 @@
+"""Generate drivers/tags/tag_hash.h: the tags of one node and their minimal perfect hash.
+
+Usage: python3 tools/gen_tag_hash.py ../rpi/data/arduinos_config.json [--device OSC-01] [-o drivers/tags/tag_hash.h]
+
+The tags are the "allowed_tags" of the device: card IDs as 10 hex chars (12
+with the checksum of the reader frame, which is checked and dropped), or
+{"name": "PSU-02", "card": "AABBCCDDEE"} objects. A tag given as a plain ID
+is named after the device when it is the only one, else after its card.
+
+The firmware finds a decoded ID with one hash and one displacement read
+(drivers/tags/tag_table.cpp):
+
+    h = FNV-1a 32 bits of the 5 ID bytes, from TAG_HASH_SEED
+    d = displacement[(h & 0xFFFF) % TAG_HASH_BUCKETS]
+    index = (((h ^ d * 0x9E3779B1) * 0x85EBCA6B) >> 16) % tag count
+
+(32-bit arithmetic)
+then compares the ID stored at that index. The tags are emitted in index
+order, so the table has no empty slot. Only flash is used.
+"""
+import argparse
+import json
+import sys
+
+FNV_PRIME = 16777619
+DISPLACE_MULTIPLIER = 0x9E3779B1
+MIX_MULTIPLIER = 0x85EBCA6B
+MAX_DISPLACEMENT = 255  # uint8_t in flash
+NAME_MAX = 7
+
+
+def tag_hash(card, seed):
+    h = seed
+    for byte in card:
+        h = ((h ^ byte) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def bucket_of(h, buckets):
+    return (h & 0xFFFF) % buckets
+
+
+def slot(h, displacement, count):
+    mixed = ((h ^ (displacement * DISPLACE_MULTIPLIER & 0xFFFFFFFF)) * MIX_MULTIPLIER) & 0xFFFFFFFF
+    return (mixed >> 16) % count
+
+
+def build(cards, max_seeds=10000):
+    """Return (seed, displacements, order): order[i] is the card at index i"""
+    count = len(cards)
+    buckets = max(1, (count + 1) // 2)
+    for attempt in range(max_seeds):
+        seed = (0x811C9DC5 + attempt * 0x01000193) & 0xFFFFFFFF
+        hashes = [tag_hash(card, seed) for card in cards]
+        groups = [[] for _ in range(buckets)]
+        for key, h in enumerate(hashes):
+            groups[bucket_of(h, buckets)].append(key)
+
+        displacements = [0] * buckets
+        order = [None] * count
+        # Largest buckets first, while most slots are free
+        for bucket in sorted(range(buckets), key=lambda b: -len(groups[b])):
+            keys = groups[bucket]
+            for d in range(MAX_DISPLACEMENT + 1):
+                slots = {slot(hashes[key], d, count) for key in keys}
+                if len(slots) == len(keys) and all(order[s] is None for s in slots):
+                    for key in keys:
+                        order[slot(hashes[key], d, count)] = key
+                    displacements[bucket] = d
+                    break
+            else:
+                break
+        else:
+            return seed, displacements, order
+    raise SystemExit("error: no perfect hash found, check the tag list")
+
+
+def parse_card(text, where):
+    text = text.strip().replace(" ", "")
+    try:
+        data = bytes.fromhex(text)
+    except ValueError:
+        raise SystemExit(f"error: {where}: {text!r} is not a hex card ID")
+    if len(data) == 6:
+        checksum = 0
+        for byte in data[:5]:
+            checksum ^= byte
+        if checksum != data[5]:
+            raise SystemExit(f"error: {where}: bad checksum in {text}")
+        data = data[:5]
+    if len(data) != 5:
+        raise SystemExit(f"error: {where}: a card ID has 10 hex chars, got {text!r}")
+    return data
+
+
+def device_tags(device):
+    entries = device.get("allowed_tags", [])
+    tags = []
+    for entry in entries:
+        where = f"device {device.get('id')}"
+        if isinstance(entry, dict):
+            card = parse_card(entry["card"], where)
+            name = entry.get("name") or card.hex().upper()[-NAME_MAX:]
+        else:
+            card = parse_card(entry, where)
+            name = str(device.get("id")) if len(entries) == 1 else card.hex().upper()[-NAME_MAX:]
+        if len(name.encode("ascii")) > NAME_MAX:
+            raise SystemExit(f"error: {where}: tag name {name!r} is longer than {NAME_MAX} chars")
+        tags.append((name, card))
+    return tags
+
+
+def render(tags, seed, displacements, order, source):
+    lines = [
+        f"/* Généré par tools/gen_tag_hash.py depuis {source} : ne pas modifier. */",
+        "",
+        "#ifndef TAG_HASH_H",
+        "#define TAG_HASH_H",
+        "",
+        f"#define TAG_HASH_SEED 0x{seed:08X}UL",
+        f"#define TAG_HASH_BUCKETS {len(displacements)}",
+        f"#define TAG_HASH_DISPLACEMENTS {', '.join(str(d) for d in displacements)}",
+        "",
+        "/* Tags dans l'ordre de leur index (position donnée par le hachage) */",
+        "#define TAG_TABLE(TAG) \\",
+    ]
+    for i, key in enumerate(order):
+        name, card = tags[key]
+        args = ", ".join(f"0x{byte:02X}" for byte in card)
+        lines.append(f"    TAG(\"{name}\", {args})" + (" \\" if i < len(order) - 1 else ""))
+    lines += ["", "#endif", ""]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("config")
+    parser.add_argument("--device", help="device id, needed when the config lists several devices")
+    parser.add_argument("-o", "--output", help="header to write (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.config, encoding="utf-8") as f:
+        devices = json.load(f)["devices"]
+    if args.device:
+        devices = [d for d in devices if str(d.get("id")) == args.device]
+        if not devices:
+            raise SystemExit(f"error: no device {args.device} in {args.config}")
+    elif len(devices) != 1:
+        ids = ", ".join(str(d.get("id")) for d in devices)
+        raise SystemExit(f"error: several devices in {args.config}, choose one with NODE= ({ids})")
+
+    tags = device_tags(devices[0])
+    if not tags:
+        raise SystemExit(f"error: device {devices[0].get('id')} has no allowed_tags")
+    cards = [card for _, card in tags]
+    if len(set(cards)) != len(cards):
+        raise SystemExit(f"error: device {devices[0].get('id')} lists a card twice")
+
+    seed, displacements, order = build(cards)
+    header = render(tags, seed, displacements, order, args.config)
+    if args.output:
+        with open(args.output, "w", encoding="utf-8") as f:
+            f.write(header)
+    else:
+        sys.stdout.write(header)
+
+
+if __name__ == "__main__":
+    main()